@@ -6,6 +6,8 @@
 	#else
 		#define ENGINE_API __declspec(dllimport)
 	#endif
+#elif defined(ENGINE_PLATFORM_LINUX)
+	#define ENGINE_API __attribute__((visibility("default")))
 #else
-	#error Only Windows supported
+	#error Only Windows and Linux supported
 #endif
@@ -1,12 +1,17 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 
+#if defined(ENGINE_PLATFORM_WINDOWS)
 #ifdef IS_ENGINE
 #define ENGINE_API __declspec(dllexport)
 #else
 #define ENGINE_API __declspec(dllimport)
 #endif
+#else
+#define ENGINE_API __attribute__((visibility("default")))
+#endif
 
 #if !defined(COMPILER_MSVC)
 #define COMPILER_MSVC 0
@@ -27,8 +32,12 @@
 #endif
 #endif
 
-#ifdef COMPILER_MSVC
+#if COMPILER_MSVC
 #include <intrin.h>
+#define DebugTrap() __debugbreak()
+#else
+#include <x86intrin.h>
+#define DebugTrap() __builtin_trap()
 #endif // COMPILER_MSVC
 
 
@@ -60,9 +69,9 @@ using MemoryIndex = size_t;
 #define TeraBytes(Value) (1024ull * GigaBytes(Value))
 
 #if ENGINE_BUILD_DEBUG
-	#define Assert(Expression) if(!(Expression)) {__debugbreak();}
-	#define Ensure(Expression) ((Expression) || ([] () {__debugbreak();}(), false))
-	#define Halt() __debugbreak()
+	#define Assert(Expression) if(!(Expression)) {DebugTrap();}
+	#define Ensure(Expression) ((Expression) || ([] () {DebugTrap();}(), false))
+	#define Halt() DebugTrap()
 	#define InvalidCodePath() Assert(false)
 #else
 	#define Assert(Expression)
@@ -71,6 +80,13 @@ using MemoryIndex = size_t;
 	#define InvalidCodePath()
 #endif // ENGINE_BUILD_DEBUG
 
+//Note: stops the program in every build, for errors the game cannot carry on from
+#if defined(__clang__) || defined(__GNUC__)
+	#define Trap() __builtin_trap()
+#else
+	#define Trap() __fastfail(7)
+#endif
+
 internal_static u32 SafeTruncate32(i64 value)
 {
 	Assert(value <= 0xffffffff); //should be less than max dword 32bit
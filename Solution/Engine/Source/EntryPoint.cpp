@@ -9,6 +9,16 @@
 #include "Math.hpp"
 
 #include "World.cpp"
+#include "SpriteAtlas.cpp"
+
+//Note: the one definition of the platform callbacks the headers declare, set at the top of every PlatformLoop
+FuncPlatformReportArenaOverflow* global_report_arena_overflow;
+FuncPlatformCommitMemory* global_platform_commit_memory;
+FuncPlatformAddWorkEntry* global_platform_add_work_entry;
+FuncPlatformCompleteAllWork* global_platform_complete_all_work;
+u32 global_platform_work_thread_count;
+FuncPlatformGetWallClockMicroseconds* global_platform_get_wall_clock;
+GameMemory* debug_global_memory;
 
 internal_static void GameOutputSound(const GameSoundBuffer& buffer, u32 tone_frequency)
 {
@@ -29,65 +39,194 @@ internal_static void GameOutputSound(const GameSoundBuffer& buffer, u32 tone_fre
 	}
 }
 
-internal_static void RenderGradient(const GameOffscreenBuffer& bitmap_buffer, i32 x_offset, i32 y_offset)
+inline Rectangle2i GetBufferRect(const GameOffscreenBuffer& buffer)
 {
-	//todo: test buffer pass by value performance
-	u8* row = static_cast<u8*>(bitmap_buffer.memory);
-	for (int y = 0; y < bitmap_buffer.height; ++y)
+	Rectangle2i result{ 0, 0, buffer.width, buffer.height };
+	return result;
+}
+
+//Note: adds each byte on its own, wrapping instead of carrying into the next one
+inline u32 AddPixelBytes(u32 a, u32 b)
+{
+	u32 result = ((a & 0x7F7F7F7F) + (b & 0x7F7F7F7F)) ^ ((a ^ b) & 0x80808080);
+	return result;
+}
+
+//Note: every byte of a pixel is that byte of first_pixel plus x times that byte of pixel_step, so a pixel_step of 0 is a
+//flat fill. The pixels up to the vector alignment are written one at a time, the vector stores are aligned
+internal_static void FillRow(u32* dest, i32 count, u32 first_pixel, u32 pixel_step, b32 streaming)
+{
+#if defined(__AVX2__)
+	constexpr MemoryIndex vector_alignment = 32;
+#else
+	constexpr MemoryIndex vector_alignment = 16;
+#endif
+
+	u32 pixel = first_pixel;
+	i32 x = 0;
+	for (; x < count && (reinterpret_cast<MemoryIndex>(dest + x) & (vector_alignment - 1)); ++x)
 	{
-		u32* pixel = reinterpret_cast<u32*>(row);
-		for (int x = 0; x < bitmap_buffer.width; ++x)
+		dest[x] = pixel;
+		pixel = AddPixelBytes(pixel, pixel_step);
+	}
+
+	u32 step_2x = AddPixelBytes(pixel_step, pixel_step);
+	u32 step_4x = AddPixelBytes(step_2x, step_2x);
+
+#if defined(__AVX2__)
+	if (x + 8 <= count)
+	{
+		u32 step_8x = AddPixelBytes(step_4x, step_4x);
+		u32 lanes[8];
+		for (u32 lane = 0; lane < 8; ++lane)
 		{
-			//Memory:		BB GG RR 00 - Little Endian
-			//Registers:	xx RR GG BB
-			u8 blue = static_cast<u8>(x + x_offset);
-			u8 green = static_cast<u8>(y + y_offset);
-			*pixel++ = static_cast<u32>((green << 16) | blue);
+			lanes[lane] = pixel;
+			pixel = AddPixelBytes(pixel, pixel_step);
 		}
 
-		row += bitmap_buffer.pitch;
+		__m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(lanes));
+		__m256i step = _mm256_set1_epi32(static_cast<i32>(step_8x));
+		if (streaming)
+		{
+			for (; x + 8 <= count; x += 8)
+			{
+				_mm256_stream_si256(reinterpret_cast<__m256i*>(dest + x), value);
+				value = _mm256_add_epi8(value, step);
+			}
+		}
+		else
+		{
+			for (; x + 8 <= count; x += 8)
+			{
+				_mm256_store_si256(reinterpret_cast<__m256i*>(dest + x), value);
+				value = _mm256_add_epi8(value, step);
+			}
+		}
+		pixel = static_cast<u32>(_mm_cvtsi128_si32(_mm256_castsi256_si128(value)));
 	}
-}
+#endif
 
-internal_static void DrawRectangle(const GameOffscreenBuffer& buffer, V2 min, V2 max, r32 colour_r, r32 colour_g, r32 colour_b
-)
-{
-	i32 imin_x = RoundToI32(min.x);
-	i32 imin_y = RoundToI32(min.y);
-	i32 imax_x = RoundToI32(max.x);
-	i32 imax_y = RoundToI32(max.y);
+	if (x + 4 <= count)
+	{
+		u32 lanes[4];
+		for (u32 lane = 0; lane < 4; ++lane)
+		{
+			lanes[lane] = pixel;
+			pixel = AddPixelBytes(pixel, pixel_step);
+		}
+
+		__m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lanes));
+		__m128i step = _mm_set1_epi32(static_cast<i32>(step_4x));
+		if (streaming)
+		{
+			for (; x + 4 <= count; x += 4)
+			{
+				_mm_stream_si128(reinterpret_cast<__m128i*>(dest + x), value);
+				value = _mm_add_epi8(value, step);
+			}
+		}
+		else
+		{
+			for (; x + 4 <= count; x += 4)
+			{
+				_mm_store_si128(reinterpret_cast<__m128i*>(dest + x), value);
+				value = _mm_add_epi8(value, step);
+			}
+		}
+		pixel = static_cast<u32>(_mm_cvtsi128_si32(value));
+	}
 
-	if (imin_x < 0)
+	for (; x < count; ++x)
 	{
-		imin_x = 0;
+		dest[x] = pixel;
+		pixel = AddPixelBytes(pixel, pixel_step);
 	}
-	if (imin_y < 0)
+}
+
+//Note: rect must lie within the buffer. Fills bigger than FILL_STREAMING_MIN_SIZE use non-temporal stores and are
+//fenced before returning, so another thread can read them once it has synchronized with this one
+internal_static void FillRectangle(const GameOffscreenBuffer& buffer, Rectangle2i rect, u32 colour)
+{
+	if (HasArea(rect))
 	{
-		imin_y = 0;
+		b32 streaming = static_cast<MemoryIndex>(GetArea(rect)) * static_cast<MemoryIndex>(buffer.bytes_per_pixel) >= FILL_STREAMING_MIN_SIZE;
+		i32 width = rect.max_x - rect.min_x;
+		u8* row = static_cast<u8*>(buffer.memory) + rect.min_x * buffer.bytes_per_pixel + rect.min_y * buffer.pitch;
+		for (i32 y = rect.min_y; y < rect.max_y; ++y)
+		{
+			FillRow(reinterpret_cast<u32*>(row), width, colour, 0, streaming);
+			row += buffer.pitch;
+		}
+
+		if (streaming)
+		{
+			_mm_sfence();
+		}
 	}
-	if (imax_x > buffer.width)
+}
+
+//Note: blue ramps with x and green with y, both wrapping every 256 pixels
+internal_static void RenderGradient(const GameOffscreenBuffer& bitmap_buffer, i32 x_offset, i32 y_offset)
+{
+	b32 streaming = static_cast<MemoryIndex>(GetArea(GetBufferRect(bitmap_buffer))) * static_cast<MemoryIndex>(bitmap_buffer.bytes_per_pixel) >= FILL_STREAMING_MIN_SIZE;
+	u8* row = static_cast<u8*>(bitmap_buffer.memory);
+	for (int y = 0; y < bitmap_buffer.height; ++y)
 	{
-		imax_x = buffer.width;
+		//Memory:		BB GG RR 00 - Little Endian
+		//Registers:	xx RR GG BB
+		u8 blue = static_cast<u8>(x_offset);
+		u8 green = static_cast<u8>(y + y_offset);
+		FillRow(reinterpret_cast<u32*>(row), bitmap_buffer.width, static_cast<u32>((green << 16) | blue), 1, streaming);
+
+		row += bitmap_buffer.pitch;
 	}
-	if (imax_y > buffer.height)
+
+	if (streaming)
 	{
-		imax_y = buffer.height;
+		_mm_sfence();
 	}
+}
 
-	u32 colour = RoundToU32(colour_r * 255.f) << 16 
+inline u32 PackColour(r32 colour_r, r32 colour_g, r32 colour_b)
+{
+	u32 result = RoundToU32(colour_r * 255.f) << 16
 		| RoundToU32(colour_g * 255.f) << 8
 		| RoundToU32(colour_b * 255.f);
+	return result;
+}
 
-	u8* row = static_cast<u8*>(buffer.memory) + imin_x * buffer.bytes_per_pixel + imin_y * buffer.pitch;
-	
-	for (int y = imin_y; y < imax_y; ++y)
+//Note: clip is in buffer pixels and must lie within the buffer
+internal_static void DrawRectangle(const GameOffscreenBuffer& buffer, Rectangle2i clip, V2 min, V2 max, u32 colour)
+{
+	Rectangle2i rect{ RoundToI32(min.x), RoundToI32(min.y), RoundToI32(max.x), RoundToI32(max.y) };
+	FillRectangle(buffer, Intersect(rect, clip), colour);
+}
+
+//Note: layer must be the size of buffer, the rows inside clip are copied over whatever is there
+internal_static void DrawLayer(const GameOffscreenBuffer& buffer, Rectangle2i clip, const GameOffscreenBuffer& layer)
+{
+	Assert(layer.width == buffer.width && layer.height == buffer.height);
+
+	i32 width = clip.max_x - clip.min_x;
+	u8* dest_row = static_cast<u8*>(buffer.memory) + clip.min_x * buffer.bytes_per_pixel + clip.min_y * buffer.pitch;
+	const u8* source_row = static_cast<const u8*>(layer.memory) + clip.min_x * layer.bytes_per_pixel + clip.min_y * layer.pitch;
+	for (i32 y = clip.min_y; y < clip.max_y; ++y)
 	{
-		u32* pixel = reinterpret_cast<u32*>(row);
-		for (int x = imin_x; x < imax_x; ++x)
+		u32* dest = reinterpret_cast<u32*>(dest_row);
+		const u32* source = reinterpret_cast<const u32*>(source_row);
+
+		i32 x = 0;
+		for (; x + 4 <= width; x += 4)
 		{
-			*pixel++ = colour;
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x), _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + x)));
 		}
-		row += buffer.pitch;
+		for (; x < width; ++x)
+		{
+			dest[x] = source[x];
+		}
+
+		dest_row += buffer.pitch;
+		source_row += layer.pitch;
 	}
 }
 
@@ -119,23 +258,153 @@ struct BitmapHeader
 };
 #pragma pack(pop)
 
-internal_static LoadedBitmap Debug_LoadBMP(ThreadContext& thread, FuncPlatformRead* read_entire_file, char* filename)
+//Note: straight to premultiplied alpha, c * a / 255 with exact rounding. The alpha channel is kept
+inline u32 PremultiplyPixel(u32 colour)
+{
+	u32 alpha = colour >> 24;
+	u32 result = colour & 0xFF000000;
+	for (u32 shift = 0; shift < 24; shift += 8)
+	{
+		u32 scaled = ((colour >> shift) & 0xFF) * alpha + 128;
+		result |= ((scaled + (scaled >> 8)) >> 8) << shift;
+	}
+
+	return result;
+}
+
+inline __m128i RotateLeft4x(__m128i value, i32 amount)
+{
+	amount &= 31;
+	return _mm_or_si128(_mm_sll_epi32(value, _mm_cvtsi32_si128(amount)), _mm_srl_epi32(value, _mm_cvtsi32_si128(32 - amount)));
+}
+
+#if defined(__AVX2__)
+inline __m256i RotateLeft8x(__m256i value, i32 amount)
+{
+	amount &= 31;
+	return _mm256_or_si256(_mm256_sll_epi32(value, _mm_cvtsi32_si128(amount)), _mm256_srl_epi32(value, _mm_cvtsi32_si128(32 - amount)));
+}
+#endif
+
+//Note: moves each masked channel to the byte DrawBitmap expects, a r g b from high to low, then premultiplies by alpha.
+//Eight pixels at a time under avx2, then four, all unaligned, the pixels sit wherever the file put them
+internal_static void SwizzleAndPremultiplyPixels(u32* pixels, u32 pixel_count, u32 red_mask, u32 green_mask, u32 blue_mask, u32 alpha_mask,
+	i32 red_shift, i32 green_shift, i32 blue_shift, i32 alpha_shift)
+{
+	__m128i red_mask_4x = _mm_set1_epi32(static_cast<i32>(red_mask));
+	__m128i green_mask_4x = _mm_set1_epi32(static_cast<i32>(green_mask));
+	__m128i blue_mask_4x = _mm_set1_epi32(static_cast<i32>(blue_mask));
+	__m128i alpha_mask_4x = _mm_set1_epi32(static_cast<i32>(alpha_mask));
+	__m128i alpha_byte_4x = _mm_set1_epi32(static_cast<i32>(0xFF000000));
+	__m128i zero = _mm_setzero_si128();
+
+	u32 pixel_index = 0;
+
+#if defined(__AVX2__)
+	__m256i red_mask_8x = _mm256_set1_epi32(static_cast<i32>(red_mask));
+	__m256i green_mask_8x = _mm256_set1_epi32(static_cast<i32>(green_mask));
+	__m256i blue_mask_8x = _mm256_set1_epi32(static_cast<i32>(blue_mask));
+	__m256i alpha_mask_8x = _mm256_set1_epi32(static_cast<i32>(alpha_mask));
+	__m256i alpha_byte_8x = _mm256_set1_epi32(static_cast<i32>(0xFF000000));
+	__m256i zero_8x = _mm256_setzero_si256();
+	for (; pixel_index + 8 <= pixel_count; pixel_index += 8)
+	{
+		__m256i* source_dest = reinterpret_cast<__m256i*>(pixels + pixel_index);
+		__m256i colour = _mm256_loadu_si256(source_dest);
+		colour = _mm256_or_si256(
+			_mm256_or_si256(RotateLeft8x(_mm256_and_si256(colour, red_mask_8x), red_shift), RotateLeft8x(_mm256_and_si256(colour, green_mask_8x), green_shift)),
+			_mm256_or_si256(RotateLeft8x(_mm256_and_si256(colour, blue_mask_8x), blue_shift), RotateLeft8x(_mm256_and_si256(colour, alpha_mask_8x), alpha_shift)));
+
+		__m256i low = _mm256_unpacklo_epi8(colour, zero_8x);
+		__m256i high = _mm256_unpackhi_epi8(colour, zero_8x);
+		__m256i low_alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(low, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		__m256i high_alpha = _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(high, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		low = _mm256_add_epi16(_mm256_mullo_epi16(low, low_alpha), _mm256_set1_epi16(128));
+		high = _mm256_add_epi16(_mm256_mullo_epi16(high, high_alpha), _mm256_set1_epi16(128));
+		low = _mm256_srli_epi16(_mm256_add_epi16(low, _mm256_srli_epi16(low, 8)), 8);
+		high = _mm256_srli_epi16(_mm256_add_epi16(high, _mm256_srli_epi16(high, 8)), 8);
+
+		__m256i premultiplied = _mm256_packus_epi16(low, high);
+		_mm256_storeu_si256(source_dest, _mm256_or_si256(_mm256_andnot_si256(alpha_byte_8x, premultiplied), _mm256_and_si256(colour, alpha_byte_8x)));
+	}
+#endif
+
+	for (; pixel_index + 4 <= pixel_count; pixel_index += 4)
+	{
+		__m128i* source_dest = reinterpret_cast<__m128i*>(pixels + pixel_index);
+		__m128i colour = _mm_loadu_si128(source_dest);
+		colour = _mm_or_si128(
+			_mm_or_si128(RotateLeft4x(_mm_and_si128(colour, red_mask_4x), red_shift), RotateLeft4x(_mm_and_si128(colour, green_mask_4x), green_shift)),
+			_mm_or_si128(RotateLeft4x(_mm_and_si128(colour, blue_mask_4x), blue_shift), RotateLeft4x(_mm_and_si128(colour, alpha_mask_4x), alpha_shift)));
+
+		//Note: 16 bit lanes of two pixels each, the alpha lane of each pixel broadcast over its channels
+		__m128i low = _mm_unpacklo_epi8(colour, zero);
+		__m128i high = _mm_unpackhi_epi8(colour, zero);
+		__m128i low_alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(low, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		__m128i high_alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(high, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+		low = _mm_add_epi16(_mm_mullo_epi16(low, low_alpha), _mm_set1_epi16(128));
+		high = _mm_add_epi16(_mm_mullo_epi16(high, high_alpha), _mm_set1_epi16(128));
+		low = _mm_srli_epi16(_mm_add_epi16(low, _mm_srli_epi16(low, 8)), 8);
+		high = _mm_srli_epi16(_mm_add_epi16(high, _mm_srli_epi16(high, 8)), 8);
+
+		__m128i premultiplied = _mm_packus_epi16(low, high);
+		_mm_storeu_si128(source_dest, _mm_or_si128(_mm_andnot_si128(alpha_byte_4x, premultiplied), _mm_and_si128(colour, alpha_byte_4x)));
+	}
+
+	for (; pixel_index < pixel_count; ++pixel_index)
+	{
+		u32 c = pixels[pixel_index];
+		pixels[pixel_index] = PremultiplyPixel(
+			RotateLeft(c & red_mask, red_shift) |
+			RotateLeft(c & green_mask, green_shift) |
+			RotateLeft(c & blue_mask, blue_shift) |
+			RotateLeft(c & alpha_mask, alpha_shift));
+	}
+}
+
+constexpr u32 BITMAP_COMPARE_CHUNK_PIXEL_COUNT = 64;
+
+//Note: the source rows go through the same swizzle as a fresh load, a chunk at a time, and are compared against what the
+//atlas holds. Images that only differ where premultiplying rounds them together draw the same and count as equal
+internal_static b32 AreSourcePixelsInBitmap(const LoadedBitmap& bitmap, const u8* source_pixels, u32 red_mask, u32 green_mask, u32 blue_mask, u32 alpha_mask,
+	i32 red_shift, i32 green_shift, i32 blue_shift, i32 alpha_shift)
+{
+	b32 result = true;
+	MemoryIndex row_size = static_cast<MemoryIndex>(bitmap.width) * sizeof(u32);
+	u32 chunk[BITMAP_COMPARE_CHUNK_PIXEL_COUNT];
+	for (i32 y = 0; y < bitmap.height && result; ++y)
+	{
+		const u32* bitmap_row = bitmap.pixels + y * bitmap.pitch;
+		const u8* source_row = source_pixels + static_cast<MemoryIndex>(y) * row_size;
+		for (u32 x = 0; x < static_cast<u32>(bitmap.width) && result; x += BITMAP_COMPARE_CHUNK_PIXEL_COUNT)
+		{
+			u32 pixel_count = Minimum(static_cast<u32>(bitmap.width) - x, BITMAP_COMPARE_CHUNK_PIXEL_COUNT);
+			memcpy(chunk, source_row + x * sizeof(u32), pixel_count * sizeof(u32));
+			SwizzleAndPremultiplyPixels(chunk, pixel_count, red_mask, green_mask, blue_mask, alpha_mask, red_shift, green_shift, blue_shift, alpha_shift);
+			result = memcmp(chunk, bitmap_row + x, pixel_count * sizeof(u32)) == 0;
+		}
+	}
+
+	return result;
+}
+
+//Note: the pixels are copied into the atlas, swizzled and premultiplied there, and the file is freed. An image that is
+//already in the atlas, such as the same body under every head, comes back as the view of the first copy
+internal_static LoadedBitmap Debug_LoadBMP(ThreadContext& thread, FuncPlatformRead* read_entire_file, FuncPlatformFree* free_file, SpriteAtlas& atlas, const char* filename)
 {
 	LoadedBitmap result{};
 
-	const FileResult read_result = read_entire_file(thread, filename);
+	FileResult read_result = read_entire_file(thread, filename);
 
 	if (read_result.content_size != 0)
 	{
 		const auto* bitmap_header = static_cast<BitmapHeader*>(read_result.content);
-		
-		u32* pixels = reinterpret_cast<u32*>(static_cast<u8*>(read_result.content) + bitmap_header->bitmap_offset);
-		result.pixels = pixels;
-		result.width = bitmap_header->width;
-		result.height = bitmap_header->height;
 
 		Assert(bitmap_header->compression == 3);
+		Assert(bitmap_header->bits_per_pixel == 32);
 
+		i32 width = bitmap_header->width;
+		i32 height = bitmap_header->height;
 		u32 red_mask = bitmap_header->red_mask;
 		u32 green_mask = bitmap_header->green_mask;
 		u32 blue_mask = bitmap_header->blue_mask;
@@ -156,269 +425,2555 @@ internal_static LoadedBitmap Debug_LoadBMP(ThreadContext& thread, FuncPlatformRe
 		i32 blue_shift = 0 - static_cast<i32>(blue_scan.index);
 		i32 alpha_shift = 24 - static_cast<i32>(alpha_scan.index);
 
-		u32* source_dest = pixels;
-		for (i32 y = 0; y < bitmap_header->height; ++y)
+		//Note: the pixel data sits wherever the header ends, so it is only read through memcpy until it is in the atlas
+		const u8* source_pixels = static_cast<const u8*>(read_result.content) + bitmap_header->bitmap_offset;
+		MemoryIndex row_size = static_cast<MemoryIndex>(width) * sizeof(u32);
+
+		u64 content_hash = FNV_OFFSET_BASIS;
+		content_hash = HashBytes(content_hash, &width, sizeof(width));
+		content_hash = HashBytes(content_hash, &height, sizeof(height));
+		content_hash = HashBytes(content_hash, &red_mask, sizeof(red_mask));
+		content_hash = HashBytes(content_hash, &green_mask, sizeof(green_mask));
+		content_hash = HashBytes(content_hash, &blue_mask, sizeof(blue_mask));
+		content_hash = HashBytes(content_hash, source_pixels, row_size * static_cast<MemoryIndex>(height));
+
+		//Note: on the rare hash hit with other pixels the image is stored again, the later find still lands on the first
+		const LoadedBitmap* existing = FindAtlasSprite(atlas, content_hash, width, height);
+		if (existing && AreSourcePixelsInBitmap(*existing, source_pixels, red_mask, green_mask, blue_mask, alpha_mask,
+			red_shift, green_shift, blue_shift, alpha_shift))
+		{
+			result = *existing;
+		}
+		else
 		{
-			for (i32 x = 0; x < bitmap_header->width; ++x)
+			result = AddAtlasSprite(atlas, content_hash, width, height);
+			Assert(result.pixels);
+
+			for (i32 y = 0; y < height && result.pixels; ++y)
 			{
-				u32 c = *source_dest;
+				u32* dest_row = result.pixels + y * result.pitch;
+				memcpy(dest_row, source_pixels + static_cast<MemoryIndex>(y) * row_size, row_size);
 
-#if 0
-				* source_dest++ = (((c >> alpha_scan.index) & 0xFF) << 24) |
-					(((c >> red_scan.index) & 0xFF) << 16) |
-					(((c >> green_scan.index) & 0xFF) << 8) |
-					(((c >> blue_scan.index) & 0xFF) << 0);
-#else
-				* source_dest++ = (
-					RotateLeft(c & red_mask, red_shift) |
-					RotateLeft(c & green_mask, green_shift) |
-					RotateLeft(c & blue_mask, blue_shift) |
-					RotateLeft(c & alpha_mask, alpha_shift)
-				);
-#endif
+				SwizzleAndPremultiplyPixels(dest_row, static_cast<u32>(width),
+					red_mask, green_mask, blue_mask, alpha_mask, red_shift, green_shift, blue_shift, alpha_shift);
 			}
 		}
 
+		if (free_file)
+		{
+			free_file(thread, read_result);
+		}
 	}
 
 	return result;
+}
 
+void PlatformLaunch()
+{
+	//Log::Init();
 }
 
-internal_static void LoadBMP(const GameOffscreenBuffer& buffer, 
-	r32 min_x, r32 min_y, r32 max_x, r32 max_y,
-	r32 colour_r, r32 colour_g, r32 colour_b
-)
+//Note: what of a bitmap lands in the clip rect. The bitmap is stored bottom-up, source_row starts at the top visible row.
+//The rounding happens before the clipping, so a bitmap covers the same pixels however the buffer is split up
+struct BitmapDrawRegion
+{
+	i32 min_x;
+	i32 min_y;
+	i32 max_x;
+	i32 max_y;
+
+	u32* source_row;
+	u8* dest_row;
+};
+
+internal_static BitmapDrawRegion GetBitmapDrawRegion(const GameOffscreenBuffer& buffer, Rectangle2i clip, const LoadedBitmap& bitmap, r32 in_x, r32 in_y)
 {
-	i32 imin_x = RoundToI32(min_x);
-	i32 imin_y = RoundToI32(min_y);
-	i32 imax_x = RoundToI32(max_x);
-	i32 imax_y = RoundToI32(max_y);
+	BitmapDrawRegion result{};
+
+	result.min_x = RoundToI32(in_x);
+	result.min_y = RoundToI32(in_y);
+	result.max_x = static_cast<i32>(in_x + static_cast<r32>(bitmap.width));
+	result.max_y = static_cast<i32>(in_y + static_cast<r32>(bitmap.height));
 
-	if (imin_x < 0)
+	i32 source_offset_x = 0;
+	if (result.min_x < clip.min_x)
 	{
-		imin_x = 0;
+		source_offset_x = clip.min_x - result.min_x;
+		result.min_x = clip.min_x;
 	}
-	if (imin_y < 0)
+
+	i32 source_offset_y = 0;
+	if (result.min_y < clip.min_y)
 	{
-		imin_y = 0;
+		source_offset_y = clip.min_y - result.min_y;
+		result.min_y = clip.min_y;
 	}
-	if (imax_x > buffer.width)
+	if (result.max_x > clip.max_x)
 	{
-		imax_x = buffer.width;
+		result.max_x = clip.max_x;
 	}
-	if (imax_y > buffer.height)
+	if (result.max_y > clip.max_y)
 	{
-		imax_y = buffer.height;
+		result.max_y = clip.max_y;
 	}
 
-	u32 colour = RoundToU32(colour_r * 255.f) << 16 
-		| RoundToU32(colour_g * 255.f) << 8
-		| RoundToU32(colour_b * 255.f);
+	result.source_row = bitmap.pixels + bitmap.pitch * (bitmap.height - 1);
+	result.source_row += -source_offset_y * bitmap.pitch + source_offset_x;
+	result.dest_row = static_cast<u8*>(buffer.memory) + result.min_x * buffer.bytes_per_pixel + result.min_y * buffer.pitch;
 
-	u8* row = static_cast<u8*>(buffer.memory) + imin_x * buffer.bytes_per_pixel + imin_y * buffer.pitch;
-	
-	for (int y = imin_y; y < imax_y; ++y)
-	{
-		u32* pixel = reinterpret_cast<u32*>(row);
-		for (int x = imin_x; x < imax_x; ++x)
-		{
-			*pixel++ = colour;
-		}
-		row += buffer.pitch;
-	}
+	return result;
 }
 
-void PlatformLaunch()
+//Note: c_alpha as 8.8 fixed point, 256 is fully opaque
+inline u32 GetBitmapAlphaScale(r32 c_alpha)
 {
-	//Log::Init();
+	return RoundToU32(Minimum(Maximum(c_alpha, 0.f), 1.f) * 256.f);
 }
 
-void DrawBitmap(const GameOffscreenBuffer& buffer, LoadedBitmap& bitmap, r32 in_x, r32 in_y, i32 align_x = 0, i32 align_y = 0, r32 c_alpha = 1.f)
+//Note: source-over with straight alpha, d + a * (s - d) in 8 bit fixed point with exact rounding of the / 255.
+//The source's own alpha channel counts as 255, so the result's alpha is a + d_a * (1 - a).
+//What DrawBitmap did before bitmaps were premultiplied at load, kept to check BlendPixel against
+inline u32 BlendPixelStraight(u32 source, u32 dest, u32 alpha_scale)
 {
-	in_x -= static_cast<float>(align_x);
-	in_y -= static_cast<float>(align_y);
+	u32 alpha = ((source >> 24) * alpha_scale + 128) >> 8;
+	u32 inverse_alpha = 255 - alpha;
+	source |= 0xFF000000;
 
-	i32 imin_x = RoundToI32(in_x);
-	i32 imin_y = RoundToI32(in_y);
-	i32 imax_x = static_cast<i32>(in_x + static_cast<r32>(bitmap.width));
-	i32 imax_y = static_cast<i32>(in_y + static_cast<r32>(bitmap.height));
-
-	i32 source_offset_x = 0;
-	if (imin_x < 0)
+	u32 result = 0;
+	for (u32 shift = 0; shift < 32; shift += 8)
 	{
-		source_offset_x = -imin_x;
-		imin_x = 0;
+		u32 blended = ((source >> shift) & 0xFF) * alpha + ((dest >> shift) & 0xFF) * inverse_alpha + 128;
+		result |= ((blended + (blended >> 8)) >> 8) << shift;
 	}
 
-	i32 source_offset_y = 0;
-	if (imin_y < 0)
-	{
-		source_offset_y = -imin_y;
-		imin_y = 0;
-	}
-	if (imax_x > buffer.width)
-	{
-		imax_x = buffer.width;
-	}
-	if (imax_y > buffer.height)
+	return result;
+}
+
+//Note: source-over with a premultiplied source, s + d * (1 - a) per channel, alpha included. c_alpha scales every
+//channel of the source, at full c_alpha that is a no-op
+inline u32 BlendPixel(u32 source, u32 dest, u32 alpha_scale)
+{
+	u32 scaled_alpha = ((source >> 24) * alpha_scale + 128) >> 8;
+	u32 inverse_alpha = 255 - scaled_alpha;
+
+	u32 result = 0;
+	for (u32 shift = 0; shift < 32; shift += 8)
 	{
-		imax_y = buffer.height;
+		u32 scaled_source = (((source >> shift) & 0xFF) * alpha_scale + 128) >> 8;
+		u32 scaled_dest = ((dest >> shift) & 0xFF) * inverse_alpha + 128;
+		result |= Minimum(scaled_source + ((scaled_dest + (scaled_dest >> 8)) >> 8), 255u) << shift;
 	}
 
-	u32* source_row = bitmap.pixels + bitmap.width * (bitmap.height - 1);
-	source_row += -source_offset_y * bitmap.width + source_offset_x;
-	u8* dest_row = static_cast<u8*>(buffer.memory) + imin_x * buffer.bytes_per_pixel + imin_y * buffer.pitch;
-	for (i32 y = imin_y; y < imax_y; ++y)
+	return result;
+}
+
+//Note: the scalar reference the simd blitter has to match bit for bit
+internal_static void DrawBitmapReference(const GameOffscreenBuffer& buffer, Rectangle2i clip, const LoadedBitmap& bitmap, r32 in_x, r32 in_y, i32 align_x = 0, i32 align_y = 0, r32 c_alpha = 1.f)
+{
+	BitmapDrawRegion region = GetBitmapDrawRegion(buffer, clip, bitmap, in_x - static_cast<r32>(align_x), in_y - static_cast<r32>(align_y));
+	u32 alpha_scale = GetBitmapAlphaScale(c_alpha);
+
+	u32* source_row = region.source_row;
+	u8* dest_row = region.dest_row;
+	for (i32 y = region.min_y; y < region.max_y; ++y)
 	{
 		u32* dest = reinterpret_cast<u32*>(dest_row);
 		u32* source = source_row;
-		for (i32 x = imin_x; x < imax_x; ++x)
+		for (i32 x = region.min_x; x < region.max_x; ++x)
 		{
-			r32 alpha = static_cast<float>((*source >> 24) & 0xFF) / 255.f;
-			alpha *= c_alpha;
-
-			r32 source_red = static_cast<float>((*source >> 16) & 0xFF);
-			r32 source_green = static_cast<float>((*source >> 8) & 0xFF);
-			r32 source_blue = static_cast<float>((*source >> 0) & 0xFF);
-
-			r32 dest_red = static_cast<float>((*source >> 16) & 0xFF);
-			r32 dest_green = static_cast<float>((*source >> 8) & 0xFF);
-			r32 dest_blue = static_cast<float>((*source >> 0) & 0xFF);
-
-			r32 r = (1.f - alpha) * source_red + alpha * dest_red;
-			r32 g = (1.f - alpha) * source_green + alpha * dest_green;
-			r32 b = (1.f - alpha) * source_blue + alpha * dest_blue;
-
-			if ((*source >> 24) > 128)
-			{
-				*dest = (static_cast<u32>(r + 0.5f) << 16 | 
-					static_cast<u32>(g + 0.5f) << 8 |
-					static_cast<u32>(b + 0.5f) << 0);
-			}
-
+			*dest = BlendPixel(*source, *dest, alpha_scale);
 			++dest;
 			++source;
 		}
 
 		dest_row += buffer.pitch;
-		source_row -= bitmap.width;
+		source_row -= bitmap.pitch;
 	}
 }
 
-internal_static LowEntity* GetLowEntity(GameState& game_state, u32 index)
+//Note: four pixels of BlendPixel in 16 bit lanes of two pixels each. Loads and stores are unaligned, bitmaps start
+//wherever the file put them
+inline __m128i BlendPixels4x(__m128i source, __m128i dest, __m128i alpha_scale_8x16, b32 scale_source)
 {
-	LowEntity* result{};
-
-	if (index > 0 && index < game_state.low_entity_count)
+	__m128i zero = _mm_setzero_si128();
+	__m128i rounding = _mm_set1_epi16(128);
+	__m128i low_source = _mm_unpacklo_epi8(source, zero);
+	__m128i high_source = _mm_unpackhi_epi8(source, zero);
+	if (scale_source)
 	{
-		result = game_state.low_entities + index;
+		low_source = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(low_source, alpha_scale_8x16), rounding), 8);
+		high_source = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(high_source, alpha_scale_8x16), rounding), 8);
 	}
 
-	return result;
+	__m128i inverse_alpha_255 = _mm_set1_epi16(255);
+	__m128i low_inverse_alpha = _mm_sub_epi16(inverse_alpha_255, _mm_shufflehi_epi16(_mm_shufflelo_epi16(low_source, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)));
+	__m128i high_inverse_alpha = _mm_sub_epi16(inverse_alpha_255, _mm_shufflehi_epi16(_mm_shufflelo_epi16(high_source, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)));
+
+	__m128i low_dest = _mm_add_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(dest, zero), low_inverse_alpha), rounding);
+	__m128i high_dest = _mm_add_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(dest, zero), high_inverse_alpha), rounding);
+	low_dest = _mm_srli_epi16(_mm_add_epi16(low_dest, _mm_srli_epi16(low_dest, 8)), 8);
+	high_dest = _mm_srli_epi16(_mm_add_epi16(high_dest, _mm_srli_epi16(high_dest, 8)), 8);
+
+	return _mm_packus_epi16(_mm_add_epi16(low_source, low_dest), _mm_add_epi16(high_source, high_dest));
 }
 
-inline HighEntity* MakeEntityHighFrequency(GameState& game_state, u32 low_index)
+#if defined(__AVX2__)
+//Note: the unpacks, shuffles and the pack stay within 128 bit lanes, so the pixels come back in order
+inline __m256i BlendPixels8x(__m256i source, __m256i dest, __m256i alpha_scale_16x16, b32 scale_source)
 {
-	HighEntity* high_entity{};
-
-	LowEntity& low_entity = game_state.low_entities[low_index];
-	if (low_entity.high_entity_index)
+	__m256i zero = _mm256_setzero_si256();
+	__m256i rounding = _mm256_set1_epi16(128);
+	__m256i low_source = _mm256_unpacklo_epi8(source, zero);
+	__m256i high_source = _mm256_unpackhi_epi8(source, zero);
+	if (scale_source)
 	{
-		high_entity = game_state.high_entities + low_entity.high_entity_index;
+		low_source = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(low_source, alpha_scale_16x16), rounding), 8);
+		high_source = _mm256_srli_epi16(_mm256_add_epi16(_mm256_mullo_epi16(high_source, alpha_scale_16x16), rounding), 8);
 	}
-	else
-	{
-		if (game_state.high_entity_count < ArrayCount(game_state.high_entities))
-		{
-			u32 high_index = game_state.high_entity_count++;
-			high_entity = &game_state.high_entities[high_index];
 
-			WorldDifference difference = Subtract(*(game_state.world), low_entity.position, game_state.camera_position);
-			high_entity->position = difference.delta_xy;
-			high_entity->velocity = {};
-			high_entity->tile_z = low_entity.position.tile_z;
-			high_entity->facing_direction = 0;
-			high_entity->low_entity_index = low_index;
+	__m256i inverse_alpha_255 = _mm256_set1_epi16(255);
+	__m256i low_inverse_alpha = _mm256_sub_epi16(inverse_alpha_255, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(low_source, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)));
+	__m256i high_inverse_alpha = _mm256_sub_epi16(inverse_alpha_255, _mm256_shufflehi_epi16(_mm256_shufflelo_epi16(high_source, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3)));
 
-			low_entity.high_entity_index = high_index;
-		}
-		else
-		{
-			InvalidCodePath();
-		}
-	}
+	__m256i low_dest = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(dest, zero), low_inverse_alpha), rounding);
+	__m256i high_dest = _mm256_add_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(dest, zero), high_inverse_alpha), rounding);
+	low_dest = _mm256_srli_epi16(_mm256_add_epi16(low_dest, _mm256_srli_epi16(low_dest, 8)), 8);
+	high_dest = _mm256_srli_epi16(_mm256_add_epi16(high_dest, _mm256_srli_epi16(high_dest, 8)), 8);
 
-	return high_entity;
+	return _mm256_packus_epi16(_mm256_add_epi16(low_source, low_dest), _mm256_add_epi16(high_source, high_dest));
 }
+#endif
 
-inline void MakeEntityLowFrequency(GameState& game_state, u32 low_index)
+//Note: avx2 takes 8 pixels per step when the build targets it, then sse 4, then scalar for the last few of a row.
+//Runs that are all transparent are skipped and, at full c_alpha, runs that are all opaque are copied
+void DrawBitmap(const GameOffscreenBuffer& buffer, Rectangle2i clip, const LoadedBitmap& bitmap, r32 in_x, r32 in_y, i32 align_x = 0, i32 align_y = 0, r32 c_alpha = 1.f)
 {
-	LowEntity& low_entity = game_state.low_entities[low_index];
-	u32 high_index = low_entity.high_entity_index;
-	if (high_index)
+	BitmapDrawRegion region = GetBitmapDrawRegion(buffer, clip, bitmap, in_x - static_cast<r32>(align_x), in_y - static_cast<r32>(align_y));
+	u32 alpha_scale = GetBitmapAlphaScale(c_alpha);
+	b32 full_alpha = (alpha_scale == 256);
+	i32 width = region.max_x - region.min_x;
+
+#if defined(__AVX2__)
+	__m256i alpha_scale_16x16 = _mm256_set1_epi16(static_cast<i16>(alpha_scale));
+	__m256i alpha_mask_8x = _mm256_set1_epi32(static_cast<i32>(0xFF000000));
+#endif
+	__m128i alpha_scale_8x16 = _mm_set1_epi16(static_cast<i16>(alpha_scale));
+	__m128i alpha_mask_4x = _mm_set1_epi32(static_cast<i32>(0xFF000000));
+
+	u32* source_row = region.source_row;
+	u8* dest_row = region.dest_row;
+	for (i32 y = region.min_y; y < region.max_y; ++y)
 	{
-		u32 last_high_index = game_state.high_entity_count - 1;
-		if (high_index != last_high_index)
+		u32* dest = reinterpret_cast<u32*>(dest_row);
+		u32* source = source_row;
+		i32 x = 0;
+
+#if defined(__AVX2__)
+		for (; x + 8 <= width; x += 8)
+		{
+			__m256i source_8x = _mm256_loadu_si256(reinterpret_cast<__m256i*>(source + x));
+			__m256i source_alpha = _mm256_and_si256(source_8x, alpha_mask_8x);
+			if (full_alpha && _mm256_movemask_epi8(_mm256_cmpeq_epi32(source_alpha, alpha_mask_8x)) == -1)
+			{
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + x), source_8x);
+			}
+			else if (!_mm256_testz_si256(source_alpha, source_alpha))
+			{
+				__m256i dest_8x = _mm256_loadu_si256(reinterpret_cast<__m256i*>(dest + x));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + x), BlendPixels8x(source_8x, dest_8x, alpha_scale_16x16, !full_alpha));
+			}
+		}
+#endif
+
+		for (; x + 4 <= width; x += 4)
 		{
-			HighEntity& last_high_entity = game_state.high_entities[last_high_index];
-			HighEntity& deleted_high_entity = game_state.high_entities[high_index];
+			__m128i source_4x = _mm_loadu_si128(reinterpret_cast<__m128i*>(source + x));
+			__m128i source_alpha = _mm_and_si128(source_4x, alpha_mask_4x);
+			i32 opaque_mask = _mm_movemask_epi8(_mm_cmpeq_epi32(source_alpha, alpha_mask_4x));
+			i32 transparent_mask = _mm_movemask_epi8(_mm_cmpeq_epi32(source_alpha, _mm_setzero_si128()));
+			if (full_alpha && opaque_mask == 0xFFFF)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x), source_4x);
+			}
+			else if (transparent_mask != 0xFFFF)
+			{
+				__m128i dest_4x = _mm_loadu_si128(reinterpret_cast<__m128i*>(dest + x));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x), BlendPixels4x(source_4x, dest_4x, alpha_scale_8x16, !full_alpha));
+			}
+		}
 
-			deleted_high_entity = last_high_entity;
-			game_state.low_entities[last_high_entity.low_entity_index].high_entity_index = 0;
+		for (; x < width; ++x)
+		{
+			dest[x] = BlendPixel(source[x], dest[x], alpha_scale);
 		}
-		--high_index;
-		game_state.low_entities[low_index].high_entity_index = 0;
+
+		dest_row += buffer.pitch;
+		source_row -= bitmap.pitch;
 	}
 }
 
-internal_static Entity GetHighEntity(GameState& game_state, u32 low_index)
+//Note: the quad as the rasterizer walks it. A pixel centre p lands on u = (p - origin).n_x_axis, v = (p - origin).n_y_axis,
+//the axes are divided by their squared length so that runs 0 to 1 across the quad
+struct TexturedQuadSetup
 {
-	Entity result{};
+	Rectangle2i region; //Note: the quad's bounding box within the clip rect
+	V2 origin;
+	V2 n_x_axis;
+	V2 n_y_axis;
+	r32 texel_width;
+	r32 texel_height;
+	r32 max_texel_x;
+	r32 max_texel_y;
+	r32 c_alpha;
+};
 
-	if (low_index > 0 && low_index < game_state.low_entity_count)
+internal_static TexturedQuadSetup GetTexturedQuadSetup(Rectangle2i clip, const LoadedBitmap& bitmap, V2 origin, V2 x_axis, V2 y_axis, r32 c_alpha)
+{
+	TexturedQuadSetup result{};
+	result.origin = origin;
+	result.texel_width = static_cast<r32>(bitmap.width);
+	result.texel_height = static_cast<r32>(bitmap.height);
+	result.max_texel_x = static_cast<r32>(bitmap.width - 1);
+	result.max_texel_y = static_cast<r32>(bitmap.height - 1);
+	result.c_alpha = c_alpha;
+
+	r32 x_axis_length_squared = LengthSquared(x_axis);
+	r32 y_axis_length_squared = LengthSquared(y_axis);
+	if (x_axis_length_squared > 0.f && y_axis_length_squared > 0.f && bitmap.width > 0 && bitmap.height > 0)
 	{
-		result.low_index = low_index;
-		result.low = game_state.low_entities + low_index;
-		result.high = MakeEntityHighFrequency(game_state, low_index);
+		result.n_x_axis = x_axis * (1.f / x_axis_length_squared);
+		result.n_y_axis = y_axis * (1.f / y_axis_length_squared);
+
+		V2 corners[] = { origin, origin + x_axis, origin + y_axis, origin + x_axis + y_axis };
+		Rectangle2i bounds{ FloorToI32(corners[0].x), FloorToI32(corners[0].y), CeilToI32(corners[0].x), CeilToI32(corners[0].y) };
+		for (u32 corner_index = 1; corner_index < ArrayCount(corners); ++corner_index)
+		{
+			Rectangle2i corner{ FloorToI32(corners[corner_index].x), FloorToI32(corners[corner_index].y), CeilToI32(corners[corner_index].x), CeilToI32(corners[corner_index].y) };
+			bounds = Union(bounds, corner);
+		}
+		result.region = Intersect(bounds, clip);
 	}
 
 	return result;
 }
 
-inline void OffsetAndCheckFrequencyByArea(GameState& game_state, V2 offset, Rectangle high_frequency_bounds)
+inline u32 RoundToU32Nearest(r32 real)
 {
-	for (u32 high_index = 0; high_index < game_state.high_entity_count;)
-	{
-		HighEntity& high_entity = game_state.high_entities[high_index];
-		high_entity.position += offset;
+	return static_cast<u32>(_mm_cvtss_si32(_mm_set_ss(real)));
+}
+
+inline r32 UnpackChannel(u32 pixel, i32 shift)
+{
+	return static_cast<r32>((pixel >> shift) & 0xFF);
+}
 
-		if (IsInRectangle(high_frequency_bounds, high_entity.position))
+inline r32 Lerp(r32 a, r32 t, r32 b)
+{
+	return a + t * (b - a);
+}
+
+//Note: bilinear between the four texels around the sample, clamped at the bitmap's edges, then premultiplied source over
+//dest. The same operations in the same order as the wide paths, which run this for the pixels left over at a row's end
+inline void DrawTexturedQuadPixel(const TexturedQuadSetup& setup, const LoadedBitmap& bitmap, u32* dest, i32 x, i32 y)
+{
+	V2 d = V2{ static_cast<r32>(x) + .5f, static_cast<r32>(y) + .5f } - setup.origin;
+	r32 u = d.x * setup.n_x_axis.x + d.y * setup.n_x_axis.y;
+	r32 v = d.x * setup.n_y_axis.x + d.y * setup.n_y_axis.y;
+	if (u >= 0.f && u < 1.f && v >= 0.f && v < 1.f)
+	{
+		r32 texel_x = Minimum(Maximum(u * setup.texel_width - .5f, 0.f), setup.max_texel_x);
+		r32 texel_y = Minimum(Maximum(v * setup.texel_height - .5f, 0.f), setup.max_texel_y);
+		i32 texel_x0 = static_cast<i32>(texel_x);
+		i32 texel_y0 = static_cast<i32>(texel_y);
+		r32 fraction_x = texel_x - static_cast<r32>(texel_x0);
+		r32 fraction_y = texel_y - static_cast<r32>(texel_y0);
+		i32 texel_x1 = texel_x0 + (texel_x0 < bitmap.width - 1);
+		i32 texel_y1 = texel_y0 + (texel_y0 < bitmap.height - 1);
+
+		u32 texel_00 = bitmap.pixels[texel_y0 * bitmap.pitch + texel_x0];
+		u32 texel_10 = bitmap.pixels[texel_y0 * bitmap.pitch + texel_x1];
+		u32 texel_01 = bitmap.pixels[texel_y1 * bitmap.pitch + texel_x0];
+		u32 texel_11 = bitmap.pixels[texel_y1 * bitmap.pitch + texel_x1];
+
+		r32 source[4];
+		r32 dest_channels[4];
+		for (i32 channel = 0; channel < 4; ++channel)
 		{
-			++high_index;
+			i32 shift = 8 * channel;
+			r32 bottom = Lerp(UnpackChannel(texel_00, shift), fraction_x, UnpackChannel(texel_10, shift));
+			r32 top = Lerp(UnpackChannel(texel_01, shift), fraction_x, UnpackChannel(texel_11, shift));
+			source[channel] = Lerp(bottom, fraction_y, top) * setup.c_alpha;
+			dest_channels[channel] = UnpackChannel(*dest, shift);
 		}
-		else
+
+		r32 inverse_alpha = 1.f - source[3] * (1.f / 255.f);
+		u32 result = 0;
+		for (i32 channel = 0; channel < 4; ++channel)
 		{
-			MakeEntityLowFrequency(game_state, high_entity.low_entity_index);
+			r32 blended = Minimum(Maximum(source[channel] + dest_channels[channel] * inverse_alpha, 0.f), 255.f);
+			result |= RoundToU32Nearest(blended) << (8 * channel);
 		}
+		*dest = result;
 	}
 }
 
-internal_static u32 AddLowEntity(GameState& game_state, EntityType type)
+//Note: every pixel through DrawTexturedQuadPixel, what the wide paths are checked against
+internal_static void DrawTexturedQuadReference(const GameOffscreenBuffer& buffer, Rectangle2i clip, const LoadedBitmap& bitmap, V2 origin, V2 x_axis, V2 y_axis, r32 c_alpha = 1.f)
 {
-	Assert(game_state.low_entity_count < ArrayCount(game_state.low_entities));
-	u32 entity_index = game_state.low_entity_count++;
-
-	game_state.low_entities[entity_index] = {};
-	game_state.low_entities[entity_index].type = type;
-
-	return entity_index;
-}
-
-internal_static u32 AddWall(GameState& game_state, i32 tile_x, i32 tile_y, i32 tile_z)
+	TexturedQuadSetup setup = GetTexturedQuadSetup(clip, bitmap, origin, x_axis, y_axis, c_alpha);
+	u8* row = static_cast<u8*>(buffer.memory) + setup.region.min_x * buffer.bytes_per_pixel + setup.region.min_y * buffer.pitch;
+	for (i32 y = setup.region.min_y; y < setup.region.max_y; ++y)
+	{
+		u32* dest = reinterpret_cast<u32*>(row);
+		for (i32 x = setup.region.min_x; x < setup.region.max_x; ++x)
+		{
+			DrawTexturedQuadPixel(setup, bitmap, dest + (x - setup.region.min_x), x, y);
+		}
+		row += buffer.pitch;
+	}
+}
+
+inline __m128 UnpackChannel4x(__m128i pixels, i32 shift)
+{
+	return _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, shift), _mm_set1_epi32(0xFF)));
+}
+
+inline __m128 Lerp4x(__m128 a, __m128 t, __m128 b)
+{
+	return _mm_add_ps(a, _mm_mul_ps(t, _mm_sub_ps(b, a)));
+}
+
+#if defined(__AVX2__)
+inline __m256 UnpackChannel8x(__m256i pixels, i32 shift)
+{
+	return _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pixels, shift), _mm256_set1_epi32(0xFF)));
+}
+
+inline __m256 Lerp8x(__m256 a, __m256 t, __m256 b)
+{
+	return _mm256_add_ps(a, _mm256_mul_ps(t, _mm256_sub_ps(b, a)));
+}
+#endif
+
+//Note: the bitmap mapped onto origin + u * x_axis + v * y_axis for u and v in [0, 1), v running up from the bitmap's
+//bottom row. 8 then 4 pixels a step, the leftovers one at a time so nothing outside clip is read or written
+internal_static void DrawTexturedQuad(const GameOffscreenBuffer& buffer, Rectangle2i clip, const LoadedBitmap& bitmap, V2 origin, V2 x_axis, V2 y_axis, r32 c_alpha = 1.f)
+{
+	TexturedQuadSetup setup = GetTexturedQuadSetup(clip, bitmap, origin, x_axis, y_axis, c_alpha);
+
+	__m128 origin_x_4x = _mm_set1_ps(setup.origin.x);
+	__m128 origin_y_4x = _mm_set1_ps(setup.origin.y);
+	__m128 n_x_axis_x_4x = _mm_set1_ps(setup.n_x_axis.x);
+	__m128 n_x_axis_y_4x = _mm_set1_ps(setup.n_x_axis.y);
+	__m128 n_y_axis_x_4x = _mm_set1_ps(setup.n_y_axis.x);
+	__m128 n_y_axis_y_4x = _mm_set1_ps(setup.n_y_axis.y);
+	__m128 texel_width_4x = _mm_set1_ps(setup.texel_width);
+	__m128 texel_height_4x = _mm_set1_ps(setup.texel_height);
+	__m128 max_texel_x_4x = _mm_set1_ps(setup.max_texel_x);
+	__m128 max_texel_y_4x = _mm_set1_ps(setup.max_texel_y);
+	__m128 c_alpha_4x = _mm_set1_ps(setup.c_alpha);
+	__m128i last_texel_x_4x = _mm_set1_epi32(bitmap.width - 1);
+	__m128i last_texel_y_4x = _mm_set1_epi32(bitmap.height - 1);
+	__m128 zero_4x = _mm_setzero_ps();
+	__m128 one_4x = _mm_set1_ps(1.f);
+	__m128 half_4x = _mm_set1_ps(.5f);
+	__m128 max_channel_4x = _mm_set1_ps(255.f);
+	__m128 inverse_255_4x = _mm_set1_ps(1.f / 255.f);
+
+#if defined(__AVX2__)
+	__m256 origin_x_8x = _mm256_set1_ps(setup.origin.x);
+	__m256 origin_y_8x = _mm256_set1_ps(setup.origin.y);
+	__m256 n_x_axis_x_8x = _mm256_set1_ps(setup.n_x_axis.x);
+	__m256 n_x_axis_y_8x = _mm256_set1_ps(setup.n_x_axis.y);
+	__m256 n_y_axis_x_8x = _mm256_set1_ps(setup.n_y_axis.x);
+	__m256 n_y_axis_y_8x = _mm256_set1_ps(setup.n_y_axis.y);
+	__m256 texel_width_8x = _mm256_set1_ps(setup.texel_width);
+	__m256 texel_height_8x = _mm256_set1_ps(setup.texel_height);
+	__m256 max_texel_x_8x = _mm256_set1_ps(setup.max_texel_x);
+	__m256 max_texel_y_8x = _mm256_set1_ps(setup.max_texel_y);
+	__m256 c_alpha_8x = _mm256_set1_ps(setup.c_alpha);
+	__m256i last_texel_x_8x = _mm256_set1_epi32(bitmap.width - 1);
+	__m256i last_texel_y_8x = _mm256_set1_epi32(bitmap.height - 1);
+	__m256i bitmap_pitch_8x = _mm256_set1_epi32(bitmap.pitch);
+	__m256 zero_8x = _mm256_setzero_ps();
+	__m256 one_8x = _mm256_set1_ps(1.f);
+	__m256 half_8x = _mm256_set1_ps(.5f);
+	__m256 max_channel_8x = _mm256_set1_ps(255.f);
+	__m256 inverse_255_8x = _mm256_set1_ps(1.f / 255.f);
+	const i32* texels = reinterpret_cast<const i32*>(bitmap.pixels);
+#endif
+
+	u8* row = static_cast<u8*>(buffer.memory) + setup.region.min_y * buffer.pitch;
+	for (i32 y = setup.region.min_y; y < setup.region.max_y; ++y)
+	{
+		u32* dest = reinterpret_cast<u32*>(row);
+		i32 x = setup.region.min_x;
+
+#if defined(__AVX2__)
+		__m256 d_y_8x = _mm256_sub_ps(_mm256_add_ps(_mm256_set1_ps(static_cast<r32>(y)), half_8x), origin_y_8x);
+		for (; x + 8 <= setup.region.max_x; x += 8)
+		{
+			__m256 pixel_x_8x = _mm256_add_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(x), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7))), half_8x);
+			__m256 d_x_8x = _mm256_sub_ps(pixel_x_8x, origin_x_8x);
+			__m256 u = _mm256_add_ps(_mm256_mul_ps(d_x_8x, n_x_axis_x_8x), _mm256_mul_ps(d_y_8x, n_x_axis_y_8x));
+			__m256 v = _mm256_add_ps(_mm256_mul_ps(d_x_8x, n_y_axis_x_8x), _mm256_mul_ps(d_y_8x, n_y_axis_y_8x));
+			__m256 inside = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(u, zero_8x, _CMP_GE_OQ), _mm256_cmp_ps(u, one_8x, _CMP_LT_OQ)),
+				_mm256_and_ps(_mm256_cmp_ps(v, zero_8x, _CMP_GE_OQ), _mm256_cmp_ps(v, one_8x, _CMP_LT_OQ)));
+			if (_mm256_movemask_ps(inside))
+			{
+				__m256 texel_x = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_mul_ps(u, texel_width_8x), half_8x), zero_8x), max_texel_x_8x);
+				__m256 texel_y = _mm256_min_ps(_mm256_max_ps(_mm256_sub_ps(_mm256_mul_ps(v, texel_height_8x), half_8x), zero_8x), max_texel_y_8x);
+				__m256i texel_x0 = _mm256_cvttps_epi32(texel_x);
+				__m256i texel_y0 = _mm256_cvttps_epi32(texel_y);
+				__m256 fraction_x = _mm256_sub_ps(texel_x, _mm256_cvtepi32_ps(texel_x0));
+				__m256 fraction_y = _mm256_sub_ps(texel_y, _mm256_cvtepi32_ps(texel_y0));
+				__m256i texel_x1 = _mm256_sub_epi32(texel_x0, _mm256_cmpgt_epi32(last_texel_x_8x, texel_x0));
+				__m256i texel_y1 = _mm256_sub_epi32(texel_y0, _mm256_cmpgt_epi32(last_texel_y_8x, texel_y0));
+
+				__m256i row_0 = _mm256_mullo_epi32(texel_y0, bitmap_pitch_8x);
+				__m256i row_1 = _mm256_mullo_epi32(texel_y1, bitmap_pitch_8x);
+				__m256i texel_00 = _mm256_i32gather_epi32(texels, _mm256_add_epi32(row_0, texel_x0), 4);
+				__m256i texel_10 = _mm256_i32gather_epi32(texels, _mm256_add_epi32(row_0, texel_x1), 4);
+				__m256i texel_01 = _mm256_i32gather_epi32(texels, _mm256_add_epi32(row_1, texel_x0), 4);
+				__m256i texel_11 = _mm256_i32gather_epi32(texels, _mm256_add_epi32(row_1, texel_x1), 4);
+				__m256i dest_8x = _mm256_loadu_si256(reinterpret_cast<__m256i*>(dest + x));
+
+				__m256 source_channels[4];
+				__m256 dest_channels[4];
+				for (i32 channel = 0; channel < 4; ++channel)
+				{
+					i32 shift = 8 * channel;
+					__m256 bottom = Lerp8x(UnpackChannel8x(texel_00, shift), fraction_x, UnpackChannel8x(texel_10, shift));
+					__m256 top = Lerp8x(UnpackChannel8x(texel_01, shift), fraction_x, UnpackChannel8x(texel_11, shift));
+					source_channels[channel] = _mm256_mul_ps(Lerp8x(bottom, fraction_y, top), c_alpha_8x);
+					dest_channels[channel] = UnpackChannel8x(dest_8x, shift);
+				}
+
+				__m256 inverse_alpha = _mm256_sub_ps(one_8x, _mm256_mul_ps(source_channels[3], inverse_255_8x));
+				__m256i result = _mm256_setzero_si256();
+				for (i32 channel = 0; channel < 4; ++channel)
+				{
+					__m256 blended = _mm256_add_ps(source_channels[channel], _mm256_mul_ps(dest_channels[channel], inverse_alpha));
+					blended = _mm256_min_ps(_mm256_max_ps(blended, zero_8x), max_channel_8x);
+					result = _mm256_or_si256(result, _mm256_slli_epi32(_mm256_cvtps_epi32(blended), 8 * channel));
+				}
+
+				result = _mm256_blendv_epi8(dest_8x, result, _mm256_castps_si256(inside));
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + x), result);
+			}
+		}
+#endif
+
+		__m128 d_y_4x = _mm_sub_ps(_mm_add_ps(_mm_set1_ps(static_cast<r32>(y)), half_4x), origin_y_4x);
+		for (; x + 4 <= setup.region.max_x; x += 4)
+		{
+			__m128 pixel_x_4x = _mm_add_ps(_mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(x), _mm_setr_epi32(0, 1, 2, 3))), half_4x);
+			__m128 d_x_4x = _mm_sub_ps(pixel_x_4x, origin_x_4x);
+			__m128 u = _mm_add_ps(_mm_mul_ps(d_x_4x, n_x_axis_x_4x), _mm_mul_ps(d_y_4x, n_x_axis_y_4x));
+			__m128 v = _mm_add_ps(_mm_mul_ps(d_x_4x, n_y_axis_x_4x), _mm_mul_ps(d_y_4x, n_y_axis_y_4x));
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(u, zero_4x), _mm_cmplt_ps(u, one_4x)),
+				_mm_and_ps(_mm_cmpge_ps(v, zero_4x), _mm_cmplt_ps(v, one_4x)));
+			if (_mm_movemask_ps(inside))
+			{
+				__m128 texel_x = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(u, texel_width_4x), half_4x), zero_4x), max_texel_x_4x);
+				__m128 texel_y = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(v, texel_height_4x), half_4x), zero_4x), max_texel_y_4x);
+				__m128i texel_x0 = _mm_cvttps_epi32(texel_x);
+				__m128i texel_y0 = _mm_cvttps_epi32(texel_y);
+				__m128 fraction_x = _mm_sub_ps(texel_x, _mm_cvtepi32_ps(texel_x0));
+				__m128 fraction_y = _mm_sub_ps(texel_y, _mm_cvtepi32_ps(texel_y0));
+				__m128i texel_x1 = _mm_sub_epi32(texel_x0, _mm_cmpgt_epi32(last_texel_x_4x, texel_x0));
+				__m128i texel_y1 = _mm_sub_epi32(texel_y0, _mm_cmpgt_epi32(last_texel_y_4x, texel_y0));
+
+				//Note: sse2 has neither a gather nor a 32 bit multiply, the lookups go through memory
+				i32 x0[4];
+				i32 x1[4];
+				i32 y0[4];
+				i32 y1[4];
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(x0), texel_x0);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(x1), texel_x1);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(y0), texel_y0);
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(y1), texel_y1);
+				u32 texels_00[4];
+				u32 texels_10[4];
+				u32 texels_01[4];
+				u32 texels_11[4];
+				for (u32 lane = 0; lane < 4; ++lane)
+				{
+					const u32* row_0 = bitmap.pixels + y0[lane] * bitmap.pitch;
+					const u32* row_1 = bitmap.pixels + y1[lane] * bitmap.pitch;
+					texels_00[lane] = row_0[x0[lane]];
+					texels_10[lane] = row_0[x1[lane]];
+					texels_01[lane] = row_1[x0[lane]];
+					texels_11[lane] = row_1[x1[lane]];
+				}
+				__m128i texel_00 = _mm_loadu_si128(reinterpret_cast<__m128i*>(texels_00));
+				__m128i texel_10 = _mm_loadu_si128(reinterpret_cast<__m128i*>(texels_10));
+				__m128i texel_01 = _mm_loadu_si128(reinterpret_cast<__m128i*>(texels_01));
+				__m128i texel_11 = _mm_loadu_si128(reinterpret_cast<__m128i*>(texels_11));
+				__m128i dest_4x = _mm_loadu_si128(reinterpret_cast<__m128i*>(dest + x));
+
+				__m128 source_channels[4];
+				__m128 dest_channels[4];
+				for (i32 channel = 0; channel < 4; ++channel)
+				{
+					i32 shift = 8 * channel;
+					__m128 bottom = Lerp4x(UnpackChannel4x(texel_00, shift), fraction_x, UnpackChannel4x(texel_10, shift));
+					__m128 top = Lerp4x(UnpackChannel4x(texel_01, shift), fraction_x, UnpackChannel4x(texel_11, shift));
+					source_channels[channel] = _mm_mul_ps(Lerp4x(bottom, fraction_y, top), c_alpha_4x);
+					dest_channels[channel] = UnpackChannel4x(dest_4x, shift);
+				}
+
+				__m128 inverse_alpha = _mm_sub_ps(one_4x, _mm_mul_ps(source_channels[3], inverse_255_4x));
+				__m128i result = _mm_setzero_si128();
+				for (i32 channel = 0; channel < 4; ++channel)
+				{
+					__m128 blended = _mm_add_ps(source_channels[channel], _mm_mul_ps(dest_channels[channel], inverse_alpha));
+					blended = _mm_min_ps(_mm_max_ps(blended, zero_4x), max_channel_4x);
+					result = _mm_or_si128(result, _mm_slli_epi32(_mm_cvtps_epi32(blended), 8 * channel));
+				}
+
+				__m128i inside_mask = _mm_castps_si128(inside);
+				result = _mm_or_si128(_mm_and_si128(inside_mask, result), _mm_andnot_si128(inside_mask, dest_4x));
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + x), result);
+			}
+		}
+
+		for (; x < setup.region.max_x; ++x)
+		{
+			DrawTexturedQuadPixel(setup, bitmap, dest + x, x, y);
+		}
+
+		row += buffer.pitch;
+	}
+}
+
+//Note: the reference path draws into buffers[0] and the optimized one into buffers[1]. Both are cleared and pushed
+//onto the arena, so they go away with the caller's temporary block
+internal_static void Debug_PushComparisonBuffers(MemoryArena& arena, i32 width, i32 height, GameOffscreenBuffer (&buffers)[2])
+{
+	for (u32 buffer_index = 0; buffer_index < ArrayCount(buffers); ++buffer_index)
+	{
+		GameOffscreenBuffer& buffer = buffers[buffer_index];
+		buffer = {};
+		buffer.width = width;
+		buffer.height = height;
+		buffer.bytes_per_pixel = 4;
+		buffer.pitch = width * buffer.bytes_per_pixel;
+		buffer.memory = PushArray(arena, static_cast<MemoryIndex>(width * height), u32, ArenaTag_FrameScratch, Align(CACHE_LINE_SIZE, true));
+	}
+}
+
+internal_static u32 Debug_CountMismatchedPixels(const GameOffscreenBuffer (&buffers)[2])
+{
+	u32 result = 0;
+	u32* reference_pixels = static_cast<u32*>(buffers[0].memory);
+	u32* optimized_pixels = static_cast<u32*>(buffers[1].memory);
+	for (i32 pixel_index = 0; pixel_index < buffers[0].width * buffers[0].height; ++pixel_index)
+	{
+		result += reference_pixels[pixel_index] != optimized_pixels[pixel_index];
+	}
+
+	return result;
+}
+
+struct Debug_DrawBitmapResult
+{
+	i32 width;
+	i32 height;
+	u32 iteration_count;
+
+	u64 reference_cycles;
+	u64 simd_cycles;
+
+	u32 mismatch_count; //Note: pixels that differ between the scalar reference and the simd blitter
+};
+
+//Note: a frame's worth of blits, the backdrop then the hero sprites at an unaligned spot and partly off the left edge.
+//Both paths draw into their own buffer in a temporary block of the given arena
+internal_static Debug_DrawBitmapResult Debug_BenchmarkDrawBitmap(MemoryArena& arena, const LoadedBitmap& backdrop, const HeroBitmap& hero_bitmap, i32 width, i32 height, u32 iteration_count)
+{
+	Debug_DrawBitmapResult result{};
+	result.width = width;
+	result.height = height;
+	result.iteration_count = iteration_count;
+
+	TemporaryMemory temp_memory = BeginTemporaryMemory(arena);
+
+	GameOffscreenBuffer buffers[2];
+	Debug_PushComparisonBuffers(arena, width, height, buffers);
+
+	V2 hero_positions[] = { V2{ 0.5f * static_cast<r32>(width) + 0.3f, 0.5f * static_cast<r32>(height) }, V2{ 13.f, 0.25f * static_cast<r32>(height) } };
+
+	u64 start_cycle_count = __rdtsc();
+	for (u32 iteration = 0; iteration < iteration_count; ++iteration)
+	{
+		DrawBitmapReference(buffers[0], GetBufferRect(buffers[0]), backdrop, 0.f, 0.f);
+		for (u32 hero_index = 0; hero_index < ArrayCount(hero_positions); ++hero_index)
+		{
+			DrawBitmapReference(buffers[0], GetBufferRect(buffers[0]), hero_bitmap.body, hero_positions[hero_index].x, hero_positions[hero_index].y, hero_bitmap.align_x, hero_bitmap.align_y);
+			DrawBitmapReference(buffers[0], GetBufferRect(buffers[0]), hero_bitmap.head, hero_positions[hero_index].x, hero_positions[hero_index].y, hero_bitmap.align_x, hero_bitmap.align_y, 0.5f);
+		}
+	}
+	result.reference_cycles = __rdtsc() - start_cycle_count;
+
+	start_cycle_count = __rdtsc();
+	for (u32 iteration = 0; iteration < iteration_count; ++iteration)
+	{
+		DrawBitmap(buffers[1], GetBufferRect(buffers[1]), backdrop, 0.f, 0.f);
+		for (u32 hero_index = 0; hero_index < ArrayCount(hero_positions); ++hero_index)
+		{
+			DrawBitmap(buffers[1], GetBufferRect(buffers[1]), hero_bitmap.body, hero_positions[hero_index].x, hero_positions[hero_index].y, hero_bitmap.align_x, hero_bitmap.align_y);
+			DrawBitmap(buffers[1], GetBufferRect(buffers[1]), hero_bitmap.head, hero_positions[hero_index].x, hero_positions[hero_index].y, hero_bitmap.align_x, hero_bitmap.align_y, 0.5f);
+		}
+	}
+	result.simd_cycles = __rdtsc() - start_cycle_count;
+
+	result.mismatch_count = Debug_CountMismatchedPixels(buffers);
+
+	EndTemporaryMemory(temp_memory);
+
+	return result;
+}
+
+struct Debug_TexturedQuadResult
+{
+	i32 width;
+	i32 height;
+	u32 iteration_count;
+
+	u64 reference_cycles; //Note: turned and scaled sprites, one pixel at a time
+	u64 simd_cycles;
+	u64 blit_cycles; //Note: the same sprites upright at 1:1 through DrawBitmap, and through the quad path
+	u64 quad_blit_cycles;
+
+	u32 mismatch_count; //Note: pixels with a channel more than 1 off between the reference and the wide paths
+	u32 blit_mismatch_count; //Note: the same between DrawBitmap and an upright 1:1 quad
+};
+
+inline b32 Debug_ArePixelsClose(u32 a, u32 b)
+{
+	b32 result = true;
+	for (i32 shift = 0; shift < 32; shift += 8)
+	{
+		i32 difference = static_cast<i32>((a >> shift) & 0xFF) - static_cast<i32>((b >> shift) & 0xFF);
+		result = result && difference >= -1 && difference <= 1;
+	}
+	return result;
+}
+
+//Note: the backdrop then hero sprites turned and scaled across the buffer, some over its edges, all clipped to a rect
+//that does not start on a vector boundary
+internal_static Debug_TexturedQuadResult Debug_BenchmarkTexturedQuad(MemoryArena& arena, const LoadedBitmap& backdrop, const HeroBitmap& hero_bitmap, i32 width, i32 height, u32 iteration_count)
+{
+	Debug_TexturedQuadResult result{};
+	result.width = width;
+	result.height = height;
+	result.iteration_count = iteration_count;
+
+	TemporaryMemory temp_memory = BeginTemporaryMemory(arena);
+
+	GameOffscreenBuffer buffers[2];
+	Debug_PushComparisonBuffers(arena, width, height, buffers);
+
+	Rectangle2i clip{ 5, 3, width - 2, height - 1 };
+	for (u32 pass = 0; pass < 2; ++pass)
+	{
+		for (u32 buffer_index = 0; buffer_index < ArrayCount(buffers); ++buffer_index)
+		{
+			GameOffscreenBuffer& buffer = buffers[buffer_index];
+			u64 start_cycle_count = __rdtsc();
+			for (u32 iteration = 0; iteration < iteration_count; ++iteration)
+			{
+				DrawBitmap(buffer, GetBufferRect(buffer), backdrop, 0.f, 0.f);
+				for (i32 sprite_index = 0; sprite_index < 12; ++sprite_index)
+				{
+					r32 x = static_cast<r32>(sprite_index * 173 % (width + 40) - 20);
+					r32 y = static_cast<r32>(sprite_index * 97 % (height + 40) - 20);
+					const LoadedBitmap& bitmap = (sprite_index & 1) ? hero_bitmap.head : hero_bitmap.body;
+					if (pass == 0)
+					{
+						r32 scale = .5f + .25f * static_cast<r32>(sprite_index % 7);
+						r32 angle = .37f * static_cast<r32>(sprite_index);
+						V2 right = scale * V2{ Cos(angle), -Sin(angle) };
+						V2 up = scale * V2{ -Sin(angle), -Cos(angle) };
+						V2 origin = V2{ x, y } - static_cast<r32>(bitmap.height) * up;
+						V2 x_axis = static_cast<r32>(bitmap.width) * right;
+						V2 y_axis = static_cast<r32>(bitmap.height) * up;
+						if (buffer_index == 0)
+						{
+							DrawTexturedQuadReference(buffer, clip, bitmap, origin, x_axis, y_axis, .8f);
+						}
+						else
+						{
+							DrawTexturedQuad(buffer, clip, bitmap, origin, x_axis, y_axis, .8f);
+						}
+					}
+					else
+					{
+						if (buffer_index == 0)
+						{
+							DrawBitmap(buffer, clip, bitmap, x, y);
+						}
+						else
+						{
+							r32 bitmap_height = static_cast<r32>(bitmap.height);
+							DrawTexturedQuad(buffer, clip, bitmap, V2{ x, y + bitmap_height }, V2{ static_cast<r32>(bitmap.width), 0.f }, V2{ 0.f, -bitmap_height });
+						}
+					}
+				}
+			}
+			u64 cycles = __rdtsc() - start_cycle_count;
+			if (pass == 0)
+			{
+				(buffer_index == 0 ? result.reference_cycles : result.simd_cycles) = cycles;
+			}
+			else
+			{
+				(buffer_index == 0 ? result.blit_cycles : result.quad_blit_cycles) = cycles;
+			}
+		}
+
+		u32* pixels_0 = static_cast<u32*>(buffers[0].memory);
+		u32* pixels_1 = static_cast<u32*>(buffers[1].memory);
+		for (i32 pixel_index = 0; pixel_index < width * height; ++pixel_index)
+		{
+			u32 mismatch = !Debug_ArePixelsClose(pixels_0[pixel_index], pixels_1[pixel_index]);
+			(pass == 0 ? result.mismatch_count : result.blit_mismatch_count) += mismatch;
+		}
+	}
+
+	EndTemporaryMemory(temp_memory);
+
+	return result;
+}
+
+internal_static void FillRectangleReference(const GameOffscreenBuffer& buffer, Rectangle2i rect, u32 colour)
+{
+	u8* row = static_cast<u8*>(buffer.memory) + rect.min_x * buffer.bytes_per_pixel + rect.min_y * buffer.pitch;
+	for (i32 y = rect.min_y; y < rect.max_y; ++y)
+	{
+		u32* pixel = reinterpret_cast<u32*>(row);
+		for (i32 x = rect.min_x; x < rect.max_x; ++x)
+		{
+			*pixel++ = colour;
+		}
+		row += buffer.pitch;
+	}
+}
+
+internal_static void RenderGradientReference(const GameOffscreenBuffer& bitmap_buffer, i32 x_offset, i32 y_offset)
+{
+	u8* row = static_cast<u8*>(bitmap_buffer.memory);
+	for (i32 y = 0; y < bitmap_buffer.height; ++y)
+	{
+		u32* pixel = reinterpret_cast<u32*>(row);
+		for (i32 x = 0; x < bitmap_buffer.width; ++x)
+		{
+			u8 blue = static_cast<u8>(x + x_offset);
+			u8 green = static_cast<u8>(y + y_offset);
+			*pixel++ = static_cast<u32>((green << 16) | blue);
+		}
+		row += bitmap_buffer.pitch;
+	}
+}
+
+struct Debug_FillRectangleResult
+{
+	i32 width;
+	i32 height;
+	u32 iteration_count;
+
+	u64 reference_small_cycles; //Note: wall sized rects at odd positions, clipped by a tile and the buffer edges
+	u64 simd_small_cycles;
+	u64 reference_clear_cycles; //Note: the whole buffer, streamed past FILL_STREAMING_MIN_SIZE
+	u64 simd_clear_cycles;
+	u64 reference_gradient_cycles;
+	u64 simd_gradient_cycles;
+
+	u32 small_mismatch_count; //Note: pixels that differ between the scalar reference and the kernel after each pass
+	u32 clear_mismatch_count;
+	u32 gradient_mismatch_count;
+};
+
+internal_static Debug_FillRectangleResult Debug_BenchmarkFillRectangle(MemoryArena& arena, i32 width, i32 height, u32 iteration_count)
+{
+	Debug_FillRectangleResult result{};
+	result.width = width;
+	result.height = height;
+	result.iteration_count = iteration_count;
+
+	TemporaryMemory temp_memory = BeginTemporaryMemory(arena);
+
+	GameOffscreenBuffer buffers[2];
+	Debug_PushComparisonBuffers(arena, width, height, buffers);
+
+	Rectangle2i clip{ 3, 0, Minimum(width, RENDER_TILE_WIDTH + 3), Minimum(height, RENDER_TILE_HEIGHT) };
+	for (u32 pass = 0; pass < 3; ++pass)
+	{
+		u64 cycles[2]{};
+		for (u32 buffer_index = 0; buffer_index < ArrayCount(buffers); ++buffer_index)
+		{
+			GameOffscreenBuffer& buffer = buffers[buffer_index];
+			u64 start_cycle_count = __rdtsc();
+			for (u32 iteration = 0; iteration < iteration_count; ++iteration)
+			{
+				if (pass == 0)
+				{
+					for (i32 rect_index = 0; rect_index < 32; ++rect_index)
+					{
+						r32 x = static_cast<r32>(rect_index * 37 % (clip.max_x + 30)) - 29.3f;
+						r32 y = static_cast<r32>(rect_index * 23 % (clip.max_y + 30)) - 28.6f;
+						V2 min{ x, y };
+						V2 max{ x + 60.f, y + 60.f };
+						u32 colour = PackColour(1.f, static_cast<r32>(rect_index) / 32.f, 0.f);
+						if (buffer_index == 0)
+						{
+							Rectangle2i rect{ RoundToI32(min.x), RoundToI32(min.y), RoundToI32(max.x), RoundToI32(max.y) };
+							rect = Intersect(rect, clip);
+							if (HasArea(rect))
+							{
+								FillRectangleReference(buffer, rect, colour);
+							}
+						}
+						else
+						{
+							DrawRectangle(buffer, clip, min, max, colour);
+						}
+					}
+				}
+				else if (pass == 1)
+				{
+					if (buffer_index == 0)
+					{
+						FillRectangleReference(buffer, GetBufferRect(buffer), iteration);
+					}
+					else
+					{
+						FillRectangle(buffer, GetBufferRect(buffer), iteration);
+					}
+				}
+				else
+				{
+					if (buffer_index == 0)
+					{
+						RenderGradientReference(buffer, static_cast<i32>(iteration) * 3, static_cast<i32>(iteration));
+					}
+					else
+					{
+						RenderGradient(buffer, static_cast<i32>(iteration) * 3, static_cast<i32>(iteration));
+					}
+				}
+			}
+			cycles[buffer_index] = __rdtsc() - start_cycle_count;
+		}
+
+		u32 mismatch_count = Debug_CountMismatchedPixels(buffers);
+		if (pass == 0)
+		{
+			result.reference_small_cycles = cycles[0];
+			result.simd_small_cycles = cycles[1];
+			result.small_mismatch_count = mismatch_count;
+		}
+		else if (pass == 1)
+		{
+			result.reference_clear_cycles = cycles[0];
+			result.simd_clear_cycles = cycles[1];
+			result.clear_mismatch_count = mismatch_count;
+		}
+		else
+		{
+			result.reference_gradient_cycles = cycles[0];
+			result.simd_gradient_cycles = cycles[1];
+			result.gradient_mismatch_count = mismatch_count;
+		}
+	}
+
+	EndTemporaryMemory(temp_memory);
+
+	return result;
+}
+
+internal_static RenderGroup* AllocateRenderGroup(MemoryArena& arena, MemoryIndex max_push_buffer_size)
+{
+	RenderGroup* result = PushStruct(arena, RenderGroup, ArenaTag_FrameScratch, Align(CACHE_LINE_SIZE, true));
+	result->push_buffer_base = static_cast<u8*>(PushSize(arena, max_push_buffer_size, ArenaTag_FrameScratch, AlignNoClear(CACHE_LINE_SIZE)));
+	result->push_buffer_size = 0;
+	result->max_push_buffer_size = max_push_buffer_size;
+	return result;
+}
+
+//Note: entries are padded to 8 bytes so the next one's pointers stay aligned. A full buffer drops the entry
+inline void* PushRenderElement_(RenderGroup& group, MemoryIndex size, RenderEntryType type)
+{
+	void* result = nullptr;
+
+	size = AlignPow2(size, 8);
+	if (group.push_buffer_size + size <= group.max_push_buffer_size)
+	{
+		result = group.push_buffer_base + group.push_buffer_size;
+		static_cast<RenderEntryHeader*>(result)->type = type;
+		group.push_buffer_size += size;
+	}
+	else
+	{
+		InvalidCodePath();
+	}
+
+	return result;
+}
+
+#define PushRenderElement(Group, Type, EntryType) static_cast<Type*>(PushRenderElement_(Group, sizeof(Type), EntryType))
+
+inline void PushBitmap(RenderGroup& group, const LoadedBitmap& bitmap, r32 x, r32 y, i32 align_x = 0, i32 align_y = 0, r32 c_alpha = 1.f)
+{
+	RenderEntryBitmap* entry = PushRenderElement(group, RenderEntryBitmap, RenderEntryType_Bitmap);
+	if (entry)
+	{
+		entry->bitmap = &bitmap;
+		entry->x = x;
+		entry->y = y;
+		entry->align_x = align_x;
+		entry->align_y = align_y;
+		entry->c_alpha = c_alpha;
+	}
+}
+
+inline void PushRectangle(RenderGroup& group, V2 min, V2 max, r32 colour_r, r32 colour_g, r32 colour_b)
+{
+	RenderEntryRectangle* entry = PushRenderElement(group, RenderEntryRectangle, RenderEntryType_Rectangle);
+	if (entry)
+	{
+		entry->min = min;
+		entry->max = max;
+		entry->colour = PackColour(colour_r, colour_g, colour_b);
+	}
+}
+
+inline void PushTexturedQuad(RenderGroup& group, const LoadedBitmap& bitmap, V2 origin, V2 x_axis, V2 y_axis, r32 c_alpha = 1.f)
+{
+	RenderEntryTexturedQuad* entry = PushRenderElement(group, RenderEntryTexturedQuad, RenderEntryType_TexturedQuad);
+	if (entry)
+	{
+		entry->bitmap = &bitmap;
+		entry->origin = origin;
+		entry->x_axis = x_axis;
+		entry->y_axis = y_axis;
+		entry->c_alpha = c_alpha;
+	}
+}
+
+struct BitmapQuad
+{
+	V2 origin;
+	V2 x_axis;
+	V2 y_axis;
+};
+
+//Note: scaled by scale and turned angle radians counter-clockwise on screen around the align point, which lands on x, y
+inline BitmapQuad GetBitmapQuad(const LoadedBitmap& bitmap, r32 x, r32 y, i32 align_x, i32 align_y, r32 scale, r32 angle)
+{
+	V2 right = scale * V2{ Cos(angle), -Sin(angle) };
+	V2 up = scale * V2{ -Sin(angle), -Cos(angle) };
+
+	BitmapQuad result;
+	result.origin = V2{ x, y } - static_cast<r32>(align_x) * right - static_cast<r32>(bitmap.height - align_y) * up;
+	result.x_axis = static_cast<r32>(bitmap.width) * right;
+	result.y_axis = static_cast<r32>(bitmap.height) * up;
+	return result;
+}
+
+//Note: the pixels a quad can touch, the same corners DrawTexturedQuad clips against
+inline Rectangle2i GetBitmapQuadBounds(const BitmapQuad& quad)
+{
+	V2 corners[] = { quad.origin, quad.origin + quad.x_axis, quad.origin + quad.y_axis, quad.origin + quad.x_axis + quad.y_axis };
+	Rectangle2i result{ FloorToI32(corners[0].x), FloorToI32(corners[0].y), CeilToI32(corners[0].x), CeilToI32(corners[0].y) };
+	for (u32 corner_index = 1; corner_index < ArrayCount(corners); ++corner_index)
+	{
+		Rectangle2i corner{ FloorToI32(corners[corner_index].x), FloorToI32(corners[corner_index].y), CeilToI32(corners[corner_index].x), CeilToI32(corners[corner_index].y) };
+		result = Union(result, corner);
+	}
+	return result;
+}
+
+//Note: see GetBitmapQuad. Unscaled and unturned it stays on the 1:1 blit
+inline void PushBitmapTransformed(RenderGroup& group, const LoadedBitmap& bitmap, r32 x, r32 y, i32 align_x, i32 align_y, r32 scale, r32 angle, r32 c_alpha = 1.f)
+{
+	if (scale == 1.f && angle == 0.f)
+	{
+		PushBitmap(group, bitmap, x, y, align_x, align_y, c_alpha);
+	}
+	else
+	{
+		BitmapQuad quad = GetBitmapQuad(bitmap, x, y, align_x, align_y, scale, angle);
+		PushTexturedQuad(group, bitmap, quad.origin, quad.x_axis, quad.y_axis, c_alpha);
+	}
+}
+
+inline void PushClear(RenderGroup& group, r32 colour_r, r32 colour_g, r32 colour_b)
+{
+	RenderEntryClear* entry = PushRenderElement(group, RenderEntryClear, RenderEntryType_Clear);
+	if (entry)
+	{
+		entry->colour = PackColour(colour_r, colour_g, colour_b);
+	}
+}
+
+inline void PushLayer(RenderGroup& group, const GameOffscreenBuffer& layer)
+{
+	RenderEntryLayer* entry = PushRenderElement(group, RenderEntryLayer, RenderEntryType_Layer);
+	if (entry)
+	{
+		entry->layer = &layer;
+	}
+}
+
+//Note: plays every entry back in push order, touching only the pixels inside clip
+internal_static void RenderGroupToOutput(const RenderGroup& group, const GameOffscreenBuffer& buffer, Rectangle2i clip)
+{
+	for (MemoryIndex base_address = 0; base_address < group.push_buffer_size;)
+	{
+		const RenderEntryHeader* header = reinterpret_cast<const RenderEntryHeader*>(group.push_buffer_base + base_address);
+		switch (header->type)
+		{
+			case RenderEntryType_Bitmap:
+			{
+				const RenderEntryBitmap* entry = reinterpret_cast<const RenderEntryBitmap*>(header);
+				DrawBitmap(buffer, clip, *entry->bitmap, entry->x, entry->y, entry->align_x, entry->align_y, entry->c_alpha);
+				base_address += AlignPow2(sizeof(RenderEntryBitmap), 8);
+			} break;
+
+			case RenderEntryType_Rectangle:
+			{
+				const RenderEntryRectangle* entry = reinterpret_cast<const RenderEntryRectangle*>(header);
+				DrawRectangle(buffer, clip, entry->min, entry->max, entry->colour);
+				base_address += AlignPow2(sizeof(RenderEntryRectangle), 8);
+			} break;
+
+			case RenderEntryType_TexturedQuad:
+			{
+				const RenderEntryTexturedQuad* entry = reinterpret_cast<const RenderEntryTexturedQuad*>(header);
+				DrawTexturedQuad(buffer, clip, *entry->bitmap, entry->origin, entry->x_axis, entry->y_axis, entry->c_alpha);
+				base_address += AlignPow2(sizeof(RenderEntryTexturedQuad), 8);
+			} break;
+
+			case RenderEntryType_Clear:
+			{
+				const RenderEntryClear* entry = reinterpret_cast<const RenderEntryClear*>(header);
+				FillRectangle(buffer, clip, entry->colour);
+				base_address += AlignPow2(sizeof(RenderEntryClear), 8);
+			} break;
+
+			case RenderEntryType_Layer:
+			{
+				const RenderEntryLayer* entry = reinterpret_cast<const RenderEntryLayer*>(header);
+				DrawLayer(buffer, clip, *entry->layer);
+				base_address += AlignPow2(sizeof(RenderEntryLayer), 8);
+			} break;
+
+			default:
+			{
+				InvalidCodePath();
+				base_address = group.push_buffer_size;
+			} break;
+		}
+	}
+}
+
+internal_static PLATFORM_WORK_QUEUE_CALLBACK(DoRenderTileWork)
+{
+	RenderTileWork& work = *static_cast<RenderTileWork*>(data);
+	RenderGroupToOutput(*work.group, *work.buffer, work.clip);
+}
+
+//Note: every tile plays back the whole group clipped to itself, tiles never share a pixel, so the result is the
+//same as one pass over the buffer whichever thread draws which tile. Without a queue the tiles are drawn in turn.
+//Only the parts of tiles inside clip_rects are drawn, the rects must not overlap for the same reason
+internal_static void TiledRenderGroupToOutput(PlatformWorkQueue* queue, const RenderGroup& group, const GameOffscreenBuffer& buffer, MemoryArena& arena,
+	const Rectangle2i* clip_rects, u32 clip_rect_count)
+{
+	i32 tile_width = RENDER_TILE_WIDTH;
+	i32 tile_height = RENDER_TILE_HEIGHT;
+	i32 tile_count_x = (buffer.width + tile_width - 1) / tile_width;
+	i32 tile_count_y = (buffer.height + tile_height - 1) / tile_height;
+	while (static_cast<u32>(tile_count_x * tile_count_y) > RENDER_TILE_MAX_COUNT)
+	{
+		tile_height *= 2;
+		tile_count_y = (buffer.height + tile_height - 1) / tile_height;
+	}
+
+	b32 use_queue = queue && global_platform_add_work_entry && global_platform_complete_all_work;
+
+	TemporaryMemory temp_memory = BeginTemporaryMemory(arena);
+
+	u32 tile_count = static_cast<u32>(tile_count_x * tile_count_y);
+	RenderTileWork* tiles = PushArray(arena, tile_count * clip_rect_count, RenderTileWork, ArenaTag_FrameScratch, Align(CACHE_LINE_SIZE, true));
+	u32 work_count = 0;
+	for (u32 clip_rect_index = 0; clip_rect_index < clip_rect_count; ++clip_rect_index)
+	{
+		Rectangle2i clip_rect = Intersect(clip_rects[clip_rect_index], GetBufferRect(buffer));
+		for (i32 tile_y = 0; tile_y < tile_count_y; ++tile_y)
+		{
+			for (i32 tile_x = 0; tile_x < tile_count_x; ++tile_x)
+			{
+				Rectangle2i tile_rect;
+				tile_rect.min_x = tile_x * tile_width;
+				tile_rect.min_y = tile_y * tile_height;
+				tile_rect.max_x = tile_rect.min_x + tile_width;
+				tile_rect.max_y = tile_rect.min_y + tile_height;
+
+				Rectangle2i clip = Intersect(tile_rect, clip_rect);
+				if (HasArea(clip))
+				{
+					RenderTileWork& work = tiles[work_count++];
+					work.group = &group;
+					work.buffer = &buffer;
+					work.clip = clip;
+
+					if (use_queue)
+					{
+						global_platform_add_work_entry(queue, DoRenderTileWork, &work);
+					}
+					else
+					{
+						DoRenderTileWork(queue, &work);
+					}
+				}
+			}
+		}
+	}
+
+	if (use_queue)
+	{
+		global_platform_complete_all_work(queue);
+	}
+
+	EndTemporaryMemory(temp_memory);
+}
+
+internal_static void TiledRenderGroupToOutput(PlatformWorkQueue* queue, const RenderGroup& group, const GameOffscreenBuffer& buffer, MemoryArena& arena)
+{
+	Rectangle2i buffer_rect = GetBufferRect(buffer);
+	TiledRenderGroupToOutput(queue, group, buffer, arena, &buffer_rect, 1);
+}
+
+//Note: rect is clipped to bounds and merged with every rect it overlaps, so the rects stay disjoint. When they are
+//all taken it goes into the one that grows the least
+internal_static void AddDirtyRect(GameDirtyRegion& region, Rectangle2i bounds, Rectangle2i rect)
+{
+	rect = Intersect(rect, bounds);
+	if (HasArea(rect))
+	{
+		b32 merged = true;
+		while (merged)
+		{
+			merged = false;
+			for (u32 rect_index = 0; rect_index < region.rect_count && !merged; ++rect_index)
+			{
+				if (HasArea(Intersect(region.rects[rect_index], rect)))
+				{
+					rect = Union(region.rects[rect_index], rect);
+					region.rects[rect_index] = region.rects[--region.rect_count];
+					merged = true;
+				}
+			}
+
+			if (!merged && region.rect_count == DIRTY_RECT_MAX_COUNT)
+			{
+				u32 best_index = 0;
+				i64 best_growth = 0;
+				for (u32 rect_index = 0; rect_index < region.rect_count; ++rect_index)
+				{
+					i64 growth = GetArea(Union(region.rects[rect_index], rect)) - GetArea(region.rects[rect_index]);
+					if (rect_index == 0 || growth < best_growth)
+					{
+						best_index = rect_index;
+						best_growth = growth;
+					}
+				}
+
+				rect = Union(region.rects[best_index], rect);
+				region.rects[best_index] = region.rects[--region.rect_count];
+				merged = true;
+			}
+		}
+
+		region.rects[region.rect_count++] = rect;
+	}
+}
+
+inline b32 IsSameDrawRecord(const EntityDrawRecord& a, const EntityDrawRecord& b)
+{
+	b32 result = a.low_index == b.low_index && a.appearance == b.appearance &&
+		a.anchor_x == b.anchor_x && a.anchor_y == b.anchor_y && a.angle == b.angle;
+	return result;
+}
+
+struct Debug_TiledRenderResult
+{
+	i32 width;
+	i32 height;
+	u32 iteration_count;
+
+	u64 single_cycles;
+	u64 tiled_cycles; //Note: through the work queue when there is one
+
+	u32 mismatch_count; //Note: pixels that differ between one pass over the buffer and the tiles
+	u32 missing_asset_count; //Note: 1 when the backdrop or the hero did not load and nothing was rendered
+};
+
+//Note: a backdrop stretched over the buffer by repeating it, a crowd of hero sprites and their rectangles, some of them
+//straddling tile edges and the buffer's edges
+internal_static Debug_TiledRenderResult Debug_BenchmarkTiledRender(MemoryArena& arena, PlatformWorkQueue* queue, const LoadedBitmap& backdrop, const HeroBitmap& hero_bitmap, i32 width, i32 height, u32 iteration_count)
+{
+	Debug_TiledRenderResult result{};
+	result.width = width;
+	result.height = height;
+	result.iteration_count = iteration_count;
+
+	//Note: an empty backdrop would never advance the loop that repeats it, so missing assets fail the check instead
+	if (backdrop.width > 0 && backdrop.height > 0 && hero_bitmap.body.width > 0 && hero_bitmap.head.width > 0)
+	{
+		TemporaryMemory temp_memory = BeginTemporaryMemory(arena);
+
+		GameOffscreenBuffer buffers[2];
+		Debug_PushComparisonBuffers(arena, width, height, buffers);
+
+		RenderGroup* group = AllocateRenderGroup(arena, MegaBytes(1));
+		for (i32 backdrop_y = 0; backdrop_y < height; backdrop_y += backdrop.height)
+		{
+			for (i32 backdrop_x = 0; backdrop_x < width; backdrop_x += backdrop.width)
+			{
+				PushBitmap(*group, backdrop, static_cast<r32>(backdrop_x), static_cast<r32>(backdrop_y));
+			}
+		}
+		for (u32 hero_index = 0; hero_index < 256; ++hero_index)
+		{
+			r32 x = static_cast<r32>((hero_index * 7919u) % static_cast<u32>(width + 64)) - 32.f + 0.3f;
+			r32 y = static_cast<r32>((hero_index * 104729u) % static_cast<u32>(height + 64)) - 32.f;
+			PushBitmap(*group, hero_bitmap.body, x, y, hero_bitmap.align_x, hero_bitmap.align_y);
+			PushBitmap(*group, hero_bitmap.head, x, y, hero_bitmap.align_x, hero_bitmap.align_y, (hero_index & 1) ? 0.5f : 1.f);
+			PushRectangle(*group, V2{ x - 30.f, y - 15.f }, V2{ x + 30.f, y + 15.f }, 1.f, 0.f, 0.f);
+		}
+
+		u64 start_cycle_count = __rdtsc();
+		for (u32 iteration = 0; iteration < iteration_count; ++iteration)
+		{
+			RenderGroupToOutput(*group, buffers[0], GetBufferRect(buffers[0]));
+		}
+		result.single_cycles = __rdtsc() - start_cycle_count;
+
+		start_cycle_count = __rdtsc();
+		for (u32 iteration = 0; iteration < iteration_count; ++iteration)
+		{
+			TiledRenderGroupToOutput(queue, *group, buffers[1], arena);
+		}
+		result.tiled_cycles = __rdtsc() - start_cycle_count;
+
+		result.mismatch_count = Debug_CountMismatchedPixels(buffers);
+
+		EndTemporaryMemory(temp_memory);
+	}
+	else
+	{
+		result.missing_asset_count = 1;
+	}
+
+	return result;
+}
+
+struct Debug_SpriteAtlasFullResult
+{
+	u32 added_count;
+	u32 mismatch_count; //Note: sprites handed a view past the sprite limit, or refused one below it
+};
+
+//Note: twice as many 16 by 16 sprites as the atlas keeps, on an atlas with room for all of them, so only the sprite
+//limit turns them away
+internal_static Debug_SpriteAtlasFullResult Debug_CheckSpriteAtlasFull(MemoryArena& arena)
+{
+	Debug_SpriteAtlasFullResult result{};
+
+	TemporaryMemory temp_memory = BeginTemporaryMemory(arena);
+
+	SpriteAtlas* atlas = PushStruct(arena, SpriteAtlas, ArenaTag_SpriteAtlas);
+	InitializeSpriteAtlas(*atlas, arena, 256, 256);
+	for (u32 sprite_index = 0; sprite_index < 2 * SPRITE_ATLAS_MAX_SPRITE_COUNT; ++sprite_index)
+	{
+		LoadedBitmap view = AddAtlasSprite(*atlas, sprite_index, 16, 16);
+		b32 expect_view = sprite_index < SPRITE_ATLAS_MAX_SPRITE_COUNT;
+		if ((view.pixels != nullptr) != expect_view)
+		{
+			++result.mismatch_count;
+		}
+		if (view.pixels)
+		{
+			++result.added_count;
+		}
+	}
+
+	EndTemporaryMemory(temp_memory);
+
+	return result;
+}
+
+struct Debug_PremultipliedBlendResult
+{
+	u32 blend_count;
+	u32 max_channel_error; //Note: premultiplying rounds once more than the straight blend, and once more again below full c_alpha
+	u32 mismatch_count; //Note: blends off by more than 1 at full c_alpha or 2 below it
+};
+
+//Note: every straight source colour and alpha against a spread of destinations and c_alpha values, blended once
+//premultiplied at load and once the straight way
+internal_static Debug_PremultipliedBlendResult Debug_CheckPremultipliedBlend()
+{
+	Debug_PremultipliedBlendResult result{};
+
+	r32 c_alphas[] = { 1.f, 0.75f, 0.5f, 0.1f };
+	for (u32 c_alpha_index = 0; c_alpha_index < ArrayCount(c_alphas); ++c_alpha_index)
+	{
+		u32 alpha_scale = GetBitmapAlphaScale(c_alphas[c_alpha_index]);
+		for (u32 alpha = 0; alpha < 256; ++alpha)
+		{
+			for (u32 channel = 0; channel < 256; ++channel)
+			{
+				u32 straight = alpha << 24 | channel << 16 | (255 - channel) << 8 | (channel * 7 & 0xFF);
+				u32 premultiplied = PremultiplyPixel(straight);
+				for (u32 dest_channel = 0; dest_channel < 256; dest_channel += 15)
+				{
+					u32 dest = (255 - dest_channel) << 24 | dest_channel << 16 | (dest_channel * 3 & 0xFF) << 8 | (255 - dest_channel);
+					u32 expected = BlendPixelStraight(straight, dest, alpha_scale);
+					u32 blended = BlendPixel(premultiplied, dest, alpha_scale);
+
+					u32 error = 0;
+					for (u32 shift = 0; shift < 32; shift += 8)
+					{
+						i32 difference = static_cast<i32>((expected >> shift) & 0xFF) - static_cast<i32>((blended >> shift) & 0xFF);
+						error = Maximum(error, static_cast<u32>(difference < 0 ? -difference : difference));
+					}
+
+					++result.blend_count;
+					result.max_channel_error = Maximum(result.max_channel_error, error);
+					result.mismatch_count += error > ((alpha_scale == 256) ? 1u : 2u);
+				}
+			}
+		}
+	}
+
+	return result;
+}
+
+internal_static LowEntity* GetLowEntity(GameState& game_state, u32 index)
+{
+	LowEntity* result{};
+
+	if (index > 0 && index < game_state.low_entity_count)
+	{
+		result = game_state.low_entities + index;
+	}
+
+	return result;
+}
+
+inline EntityHandle GetEntityHandle(GameState& game_state, u32 low_index)
+{
+	EntityHandle result{};
+
+	if (low_index > 0 && low_index < game_state.low_entity_count)
+	{
+		result.index = low_index;
+		result.generation = game_state.low_entities[low_index].generation;
+	}
+
+	return result;
+}
+
+//Note: O(1), a handle goes stale as soon as its slot is freed, whether or not the slot was reused since
+inline b32 IsEntityHandleValid(GameState& game_state, EntityHandle handle)
+{
+	b32 result = (handle.index > 0 &&
+		handle.index < game_state.low_entity_count &&
+		game_state.low_entities[handle.index].generation == handle.generation &&
+		game_state.low_entities[handle.index].type != EntityType_Null);
+	return result;
+}
+
+internal_static LowEntity* GetLowEntity(GameState& game_state, EntityHandle handle)
+{
+	LowEntity* result{};
+
+	if (IsEntityHandleValid(game_state, handle))
+	{
+		result = game_state.low_entities + handle.index;
+	}
+
+	return result;
+}
+
+internal_static void InitializeHighEntitySet(HighEntitySet& set, MemoryArena& arena, u32 max_count)
+{
+	set = {};
+	set.max_count = static_cast<u32>(AlignPow2(max_count, HIGH_ENTITY_BLOCK_SIZE));
+	set.arena = &arena;
+	set.blocks = PushArray(arena, set.max_count >> HIGH_ENTITY_BLOCK_SHIFT, HighEntityBlock*, ArenaTag_HighEntity);
+}
+
+//Note: pushes blocks until count slots are backed, false when that would pass max_count
+internal_static b32 ReserveHighEntities(HighEntitySet& set, u32 count)
+{
+	while (set.capacity < count && set.capacity < set.max_count)
+	{
+		set.blocks[set.block_count++] = PushStruct(*set.arena, HighEntityBlock, ArenaTag_HighEntity, Align(CACHE_LINE_SIZE, true));
+		set.capacity += HIGH_ENTITY_BLOCK_SIZE;
+	}
+
+	return set.capacity >= count;
+}
+
+inline HighEntitySlot GetHighEntitySlot(const HighEntitySet& set, u32 high_index)
+{
+	Assert(high_index < set.capacity);
+
+	HighEntitySlot result;
+	result.block = set.blocks[high_index >> HIGH_ENTITY_BLOCK_SHIFT];
+	result.index = high_index & HIGH_ENTITY_BLOCK_MASK;
+	return result;
+}
+
+//Note: entities in the block at block_index that are below the set count
+inline u32 GetHighEntityBlockCount(const HighEntitySet& set, u32 block_index)
+{
+	u32 first = block_index << HIGH_ENTITY_BLOCK_SHIFT;
+	return Minimum(set.count - first, HIGH_ENTITY_BLOCK_SIZE);
+}
+
+inline V2 GetHighPosition(const HighEntitySet& set, u32 high_index)
+{
+	HighEntitySlot slot = GetHighEntitySlot(set, high_index);
+	return V2{ slot.block->position_x[slot.index], slot.block->position_y[slot.index] };
+}
+
+inline void SetHighPosition(HighEntitySet& set, u32 high_index, V2 position)
+{
+	HighEntitySlot slot = GetHighEntitySlot(set, high_index);
+	slot.block->position_x[slot.index] = position.x;
+	slot.block->position_y[slot.index] = position.y;
+}
+
+inline u32 GetHighLowIndex(const HighEntitySet& set, u32 high_index)
+{
+	HighEntitySlot slot = GetHighEntitySlot(set, high_index);
+	return slot.block->low_entity_index[slot.index];
+}
+
+inline void CopyHighEntity(HighEntitySet& set, u32 dest_index, u32 source_index)
+{
+	HighEntitySlot dest = GetHighEntitySlot(set, dest_index);
+	HighEntitySlot source = GetHighEntitySlot(set, source_index);
+
+	dest.block->position_x[dest.index] = source.block->position_x[source.index];
+	dest.block->position_y[dest.index] = source.block->position_y[source.index];
+	dest.block->z[dest.index] = source.block->z[source.index];
+	dest.block->delta_z[dest.index] = source.block->delta_z[source.index];
+
+	dest.block->velocity[dest.index] = source.block->velocity[source.index];
+	dest.block->acceleration[dest.index] = source.block->acceleration[source.index];
+	dest.block->previous_offset[dest.index] = source.block->previous_offset[source.index];
+	dest.block->tile_z[dest.index] = source.block->tile_z[source.index];
+	dest.block->facing_direction[dest.index] = source.block->facing_direction[source.index];
+	dest.block->low_entity_index[dest.index] = source.block->low_entity_index[source.index];
+}
+
+//Note: the columns are cache line aligned and blocks are whole lanes, so the loops run past count without a scalar tail.
+//Avx takes 8 entities per step when the build targets it, the sse loop then only sees what avx left (nothing)
+internal_static void IntegrateHighEntityZ(HighEntitySet& set, r32 dt, r32 gravity)
+{
+	r32 gravity_offset = 0.5f * gravity * Square(dt);
+	r32 gravity_velocity = gravity * dt;
+
+#if defined(__AVX__)
+	__m256 dt_8x = _mm256_set1_ps(dt);
+	__m256 gravity_offset_8x = _mm256_set1_ps(gravity_offset);
+	__m256 gravity_velocity_8x = _mm256_set1_ps(gravity_velocity);
+	__m256 zero_8x = _mm256_setzero_ps();
+#endif
+
+	__m128 dt_4x = _mm_set1_ps(dt);
+	__m128 gravity_offset_4x = _mm_set1_ps(gravity_offset);
+	__m128 gravity_velocity_4x = _mm_set1_ps(gravity_velocity);
+	__m128 zero_4x = _mm_setzero_ps();
+
+	for (u32 block_index = 0; (block_index << HIGH_ENTITY_BLOCK_SHIFT) < set.count; ++block_index)
+	{
+		HighEntityBlock& block = *set.blocks[block_index];
+		u32 block_count = GetHighEntityBlockCount(set, block_index);
+		u32 index = 0;
+
+#if defined(__AVX__)
+		for (; index < block_count; index += 8)
+		{
+			__m256 z = _mm256_load_ps(block.z + index);
+			__m256 delta_z = _mm256_load_ps(block.delta_z + index);
+
+			z = _mm256_add_ps(z, _mm256_add_ps(gravity_offset_8x, _mm256_mul_ps(delta_z, dt_8x)));
+			delta_z = _mm256_add_ps(delta_z, gravity_velocity_8x);
+			z = _mm256_andnot_ps(_mm256_cmp_ps(z, zero_8x, _CMP_LT_OQ), z);
+
+			_mm256_store_ps(block.z + index, z);
+			_mm256_store_ps(block.delta_z + index, delta_z);
+		}
+#endif
+
+		for (; index < block_count; index += 4)
+		{
+			__m128 z = _mm_load_ps(block.z + index);
+			__m128 delta_z = _mm_load_ps(block.delta_z + index);
+
+			z = _mm_add_ps(z, _mm_add_ps(gravity_offset_4x, _mm_mul_ps(delta_z, dt_4x)));
+			delta_z = _mm_add_ps(delta_z, gravity_velocity_4x);
+			z = _mm_andnot_ps(_mm_cmplt_ps(z, zero_4x), z); //Note: clamps below ground to 0, keeps -0 like the scalar test did
+
+			_mm_store_ps(block.z + index, z);
+			_mm_store_ps(block.delta_z + index, delta_z);
+		}
+	}
+}
+
+//Note: offsets every position and returns the first entity outside bounds, count when they all stayed inside.
+//Same comparisons as IsInRectangle, min inclusive and max exclusive. Slot 0 is the null entity, it drifts with the
+//offsets but is never reported, so the result is always past it
+internal_static u32 OffsetHighEntities(HighEntitySet& set, V2 offset, Rectangle bounds)
+{
+	u32 first_outside = set.count;
+
+#if defined(__AVX__)
+	__m256 offset_x_8x = _mm256_set1_ps(offset.x);
+	__m256 offset_y_8x = _mm256_set1_ps(offset.y);
+	__m256 min_x_8x = _mm256_set1_ps(bounds.min.x);
+	__m256 min_y_8x = _mm256_set1_ps(bounds.min.y);
+	__m256 max_x_8x = _mm256_set1_ps(bounds.max.x);
+	__m256 max_y_8x = _mm256_set1_ps(bounds.max.y);
+#endif
+
+	__m128 offset_x_4x = _mm_set1_ps(offset.x);
+	__m128 offset_y_4x = _mm_set1_ps(offset.y);
+	__m128 min_x_4x = _mm_set1_ps(bounds.min.x);
+	__m128 min_y_4x = _mm_set1_ps(bounds.min.y);
+	__m128 max_x_4x = _mm_set1_ps(bounds.max.x);
+	__m128 max_y_4x = _mm_set1_ps(bounds.max.y);
+
+	for (u32 block_index = 0; (block_index << HIGH_ENTITY_BLOCK_SHIFT) < set.count; ++block_index)
+	{
+		HighEntityBlock& block = *set.blocks[block_index];
+		u32 first_in_block = block_index << HIGH_ENTITY_BLOCK_SHIFT;
+		u32 block_count = GetHighEntityBlockCount(set, block_index);
+		u32 index = 0;
+
+#if defined(__AVX__)
+		for (; index < block_count; index += 8)
+		{
+			__m256 x = _mm256_add_ps(_mm256_load_ps(block.position_x + index), offset_x_8x);
+			__m256 y = _mm256_add_ps(_mm256_load_ps(block.position_y + index), offset_y_8x);
+			_mm256_store_ps(block.position_x + index, x);
+			_mm256_store_ps(block.position_y + index, y);
+
+			__m256 inside = _mm256_and_ps(
+				_mm256_and_ps(_mm256_cmp_ps(min_x_8x, x, _CMP_LE_OQ), _mm256_cmp_ps(min_y_8x, y, _CMP_LE_OQ)),
+				_mm256_and_ps(_mm256_cmp_ps(max_x_8x, x, _CMP_GT_OQ), _mm256_cmp_ps(max_y_8x, y, _CMP_GT_OQ)));
+
+			u32 outside_mask = ~static_cast<u32>(_mm256_movemask_ps(inside)) & 0xFF;
+			if (first_in_block + index == 0)
+			{
+				outside_mask &= ~1u;
+			}
+			if (outside_mask && first_outside == set.count)
+			{
+				first_outside = Minimum(first_in_block + index + FindLeastSignificantSetBit(outside_mask).index, set.count);
+			}
+		}
+#endif
+
+		for (; index < block_count; index += 4)
+		{
+			__m128 x = _mm_add_ps(_mm_load_ps(block.position_x + index), offset_x_4x);
+			__m128 y = _mm_add_ps(_mm_load_ps(block.position_y + index), offset_y_4x);
+			_mm_store_ps(block.position_x + index, x);
+			_mm_store_ps(block.position_y + index, y);
+
+			__m128 inside = _mm_and_ps(
+				_mm_and_ps(_mm_cmple_ps(min_x_4x, x), _mm_cmple_ps(min_y_4x, y)),
+				_mm_and_ps(_mm_cmpgt_ps(max_x_4x, x), _mm_cmpgt_ps(max_y_4x, y)));
+
+			//Note: lanes past count are scratch, Minimum drops them
+			u32 outside_mask = ~static_cast<u32>(_mm_movemask_ps(inside)) & 0xF;
+			if (first_in_block + index == 0)
+			{
+				outside_mask &= ~1u;
+			}
+			if (outside_mask && first_outside == set.count)
+			{
+				first_outside = Minimum(first_in_block + index + FindLeastSignificantSetBit(outside_mask).index, set.count);
+			}
+		}
+	}
+
+	return first_outside;
+}
+
+internal_static void InitializeHighEntityGrid(HighEntityGrid& grid, MemoryArena& arena, u32 max_count, r32 cell_side)
+{
+	grid = {};
+	grid.needs_rebuild = true;
+	grid.cell_side = cell_side;
+	grid.one_over_cell_side = 1.f / cell_side;
+	grid.max_count = max_count;
+
+	grid.bucket_first = PushArray(arena, HIGH_ENTITY_GRID_BUCKET_COUNT, u32, ArenaTag_HighEntity, Align(CACHE_LINE_SIZE, true));
+	grid.bucket = PushArray(arena, max_count, u32, ArenaTag_HighEntity, Align(CACHE_LINE_SIZE, true));
+	grid.next = PushArray(arena, max_count, u32, ArenaTag_HighEntity, Align(CACHE_LINE_SIZE, true));
+	grid.prev = PushArray(arena, max_count, u32, ArenaTag_HighEntity, Align(CACHE_LINE_SIZE, true));
+	grid.cell_x = PushArray(arena, max_count, i32, ArenaTag_HighEntity, Align(CACHE_LINE_SIZE, true));
+	grid.cell_y = PushArray(arena, max_count, i32, ArenaTag_HighEntity, Align(CACHE_LINE_SIZE, true));
+	grid.movers = PushArray(arena, max_count, u32, ArenaTag_HighEntity, Align(CACHE_LINE_SIZE, true));
+	grid.mover_slot = PushArray(arena, max_count, u32, ArenaTag_HighEntity, Align(CACHE_LINE_SIZE, true));
+}
+
+//Note: tile cells for everything, chunk cells for the merged walls that would otherwise widen every gather
+internal_static void InitializeHighEntityGrids(GameState& game_state, MemoryArena& arena, u32 max_count)
+{
+	World& world = *game_state.world;
+	InitializeHighEntityGrid(game_state.high_entity_grid, arena, max_count, world.tile_side_in_meters);
+	InitializeHighEntityGrid(game_state.large_collider_grid, arena, max_count, world.tile_side_in_meters * static_cast<r32>(world.chunk_dimension));
+}
+
+//Note: sized for a gather of the whole set, left uncleared so only what a move touches gets committed
+internal_static void InitializeCollisionScratch(CollisionScratch& scratch, MemoryArena& arena, u32 max_count, ArenaTag tag)
+{
+	scratch = {};
+	scratch.candidates = PushArray(arena, max_count, u32, tag, AlignNoClear(CACHE_LINE_SIZE));
+
+	CollisionCandidates& collision_candidates = scratch.collision_candidates;
+	MemoryIndex lane_count = AlignPow2(max_count, HIGH_ENTITY_LANE_WIDTH);
+	collision_candidates.high_index = PushArray(arena, lane_count, u32, tag, AlignNoClear(CACHE_LINE_SIZE));
+	collision_candidates.position_x = PushArray(arena, lane_count, r32, tag, AlignNoClear(CACHE_LINE_SIZE));
+	collision_candidates.position_y = PushArray(arena, lane_count, r32, tag, AlignNoClear(CACHE_LINE_SIZE));
+	collision_candidates.min_corner_x = PushArray(arena, lane_count, r32, tag, AlignNoClear(CACHE_LINE_SIZE));
+	collision_candidates.min_corner_y = PushArray(arena, lane_count, r32, tag, AlignNoClear(CACHE_LINE_SIZE));
+	collision_candidates.max_corner_x = PushArray(arena, lane_count, r32, tag, AlignNoClear(CACHE_LINE_SIZE));
+	collision_candidates.max_corner_y = PushArray(arena, lane_count, r32, tag, AlignNoClear(CACHE_LINE_SIZE));
+}
+
+inline u32 GetHighEntityGridBucket(i32 cell_x, i32 cell_y)
+{
+	u32 hash_value = static_cast<u32>(cell_x) * 73856093u ^ static_cast<u32>(cell_y) * 19349663u;
+	return hash_value & (HIGH_ENTITY_GRID_BUCKET_COUNT - 1);
+}
+
+internal_static void InsertIntoHighEntityGrid(HighEntityGrid& grid, u32 high_index, i32 cell_x, i32 cell_y)
+{
+	Assert(high_index && high_index < grid.max_count);
+
+	u32 bucket = GetHighEntityGridBucket(cell_x, cell_y);
+	u32 first = grid.bucket_first[bucket];
+	grid.bucket[high_index] = bucket;
+	grid.cell_x[high_index] = cell_x;
+	grid.cell_y[high_index] = cell_y;
+	grid.prev[high_index] = 0;
+	grid.next[high_index] = first;
+	if (first)
+	{
+		grid.prev[first] = high_index;
+	}
+	grid.bucket_first[bucket] = high_index;
+}
+
+internal_static void RemoveFromHighEntityGrid(HighEntityGrid& grid, u32 high_index)
+{
+	u32 bucket = grid.bucket[high_index];
+	Assert(bucket != HIGH_ENTITY_GRID_NO_BUCKET);
+
+	u32 prev = grid.prev[high_index];
+	u32 next = grid.next[high_index];
+	if (prev)
+	{
+		grid.next[prev] = next;
+	}
+	else
+	{
+		grid.bucket_first[bucket] = next;
+	}
+	if (next)
+	{
+		grid.prev[next] = prev;
+	}
+	grid.bucket[high_index] = HIGH_ENTITY_GRID_NO_BUCKET;
+}
+
+//Note: for a mover that stays in the grid, only relinks it when its center crossed into another cell
+internal_static void UpdateHighEntityGridCell(HighEntityGrid& grid, u32 high_index, V2 position)
+{
+	if (!grid.needs_rebuild && grid.bucket[high_index] != HIGH_ENTITY_GRID_NO_BUCKET)
+	{
+		i32 cell_x = FloorToI32(position.x * grid.one_over_cell_side);
+		i32 cell_y = FloorToI32(position.y * grid.one_over_cell_side);
+		if (cell_x != grid.cell_x[high_index] || cell_y != grid.cell_y[high_index])
+		{
+			RemoveFromHighEntityGrid(grid, high_index);
+			InsertIntoHighEntityGrid(grid, high_index, cell_x, cell_y);
+		}
+	}
+}
+
+//Note: appends every entity of the grid whose center can be within the region. Regions spanning more cells than there
+//are buckets walk every bucket instead. Only reads the grid
+internal_static void GatherHighEntityCandidates(const HighEntityGrid& grid, Rectangle region, CollisionScratch& scratch)
+{
+	i32 min_cell_x = FloorToI32(region.min.x * grid.one_over_cell_side);
+	i32 min_cell_y = FloorToI32(region.min.y * grid.one_over_cell_side);
+	i32 max_cell_x = FloorToI32(region.max.x * grid.one_over_cell_side);
+	i32 max_cell_y = FloorToI32(region.max.y * grid.one_over_cell_side);
+	r32 cell_count = static_cast<r32>(max_cell_x - min_cell_x + 1) * static_cast<r32>(max_cell_y - min_cell_y + 1);
+
+	if (cell_count > static_cast<r32>(HIGH_ENTITY_GRID_BUCKET_COUNT))
+	{
+		for (u32 bucket = 0; bucket < HIGH_ENTITY_GRID_BUCKET_COUNT; ++bucket)
+		{
+			for (u32 high_index = grid.bucket_first[bucket]; high_index; high_index = grid.next[high_index])
+			{
+				scratch.candidates[scratch.candidate_count++] = high_index;
+			}
+		}
+	}
+	else
+	{
+		for (i32 cell_y = min_cell_y; cell_y <= max_cell_y; ++cell_y)
+		{
+			for (i32 cell_x = min_cell_x; cell_x <= max_cell_x; ++cell_x)
+			{
+				//Note: other cells hash into the same bucket, checking the cell also keeps an entity from being gathered twice
+				for (u32 high_index = grid.bucket_first[GetHighEntityGridBucket(cell_x, cell_y)]; high_index; high_index = grid.next[high_index])
+				{
+					if (grid.cell_x[high_index] == cell_x && grid.cell_y[high_index] == cell_y)
+					{
+						scratch.candidates[scratch.candidate_count++] = high_index;
+					}
+				}
+			}
+		}
+	}
+}
+
+//Note: a collider of the grid can block the move from as far as half its extent plus half the mover's
+inline Rectangle GetHighEntityGridGatherRegion(const HighEntityGrid& grid, V2 old_position, V2 new_position, r32 mover_extent)
+{
+	r32 margin = 0.5f * (grid.max_collider_extent + mover_extent) + 0.01f;
+	Rectangle result = RectMinMax(
+		V2{ Minimum(old_position.x, new_position.x), Minimum(old_position.y, new_position.y) } - V2{ margin, margin },
+		V2{ Maximum(old_position.x, new_position.x), Maximum(old_position.y, new_position.y) } + V2{ margin, margin });
+	return result;
+}
+
+//Note: short lists, insertion sort
+internal_static void SortHighEntityCandidates(CollisionScratch& scratch)
+{
+	for (u32 candidate_index = 1; candidate_index < scratch.candidate_count; ++candidate_index)
+	{
+		u32 high_index = scratch.candidates[candidate_index];
+		u32 dest_index = candidate_index;
+		while (dest_index && scratch.candidates[dest_index - 1] > high_index)
+		{
+			scratch.candidates[dest_index] = scratch.candidates[dest_index - 1];
+			--dest_index;
+		}
+		scratch.candidates[dest_index] = high_index;
+	}
+}
+
+inline void ClearHighEntityGrid(HighEntityGrid& grid)
+{
+	for (u32 bucket = 0; bucket < HIGH_ENTITY_GRID_BUCKET_COUNT; ++bucket)
+	{
+		grid.bucket_first[bucket] = 0;
+	}
+
+	grid.max_collider_extent = 0;
+	grid.mover_count = 0;
+	grid.needs_rebuild = false;
+}
+
+inline void AddToHighEntityGrid(HighEntityGrid& grid, u32 high_index, V2 position, r32 extent)
+{
+	InsertIntoHighEntityGrid(grid, high_index, FloorToI32(position.x * grid.one_over_cell_side), FloorToI32(position.y * grid.one_over_cell_side));
+	grid.max_collider_extent = Maximum(grid.max_collider_extent, extent);
+}
+
+//Note: adds a high entity to the mover list and to the grid its collider belongs in. The tile grid owns the mover list
+//and the rebuild flag, nothing is linked while a rebuild is pending
+internal_static void LinkHighEntityIntoGrids(GameState& game_state, u32 high_index)
+{
+	HighEntityGrid& grid = game_state.high_entity_grid;
+	HighEntityGrid& large_grid = game_state.large_collider_grid;
+	if (!grid.needs_rebuild)
+	{
+		HighEntitySet& high_entities = game_state.high_entities;
+		LowEntity& low_entity = game_state.low_entities[GetHighLowIndex(high_entities, high_index)];
+		if (low_entity.moves)
+		{
+			grid.mover_slot[high_index] = grid.mover_count;
+			grid.movers[grid.mover_count++] = high_index;
+		}
+
+		grid.bucket[high_index] = HIGH_ENTITY_GRID_NO_BUCKET;
+		large_grid.bucket[high_index] = HIGH_ENTITY_GRID_NO_BUCKET;
+		if (low_entity.collides)
+		{
+			V2 position = GetHighPosition(high_entities, high_index);
+			r32 extent = Maximum(low_entity.width, low_entity.height);
+			if (extent > LARGE_COLLIDER_CELL_COUNT * grid.cell_side)
+			{
+				AddToHighEntityGrid(large_grid, high_index, position, extent);
+			}
+			else
+			{
+				AddToHighEntityGrid(grid, high_index, position, extent);
+			}
+		}
+	}
+}
+
+//Note: the links of last_high_index move over to high_index, the same way the swap-remove moves its columns
+inline void MoveHighEntityGridLink(HighEntityGrid& grid, u32 high_index, u32 last_high_index)
+{
+	if (grid.bucket[last_high_index] != HIGH_ENTITY_GRID_NO_BUCKET)
+	{
+		i32 cell_x = grid.cell_x[last_high_index];
+		i32 cell_y = grid.cell_y[last_high_index];
+		RemoveFromHighEntityGrid(grid, last_high_index);
+		InsertIntoHighEntityGrid(grid, high_index, cell_x, cell_y);
+	}
+}
+
+//Note: called before the swap-remove of high_index, while both entities still have their low index.
+//max_collider_extent is left as it was, it only gets tighter on the next rebuild
+internal_static void UnlinkHighEntityFromGrids(GameState& game_state, u32 high_index, u32 last_high_index)
+{
+	HighEntityGrid& grid = game_state.high_entity_grid;
+	HighEntityGrid& large_grid = game_state.large_collider_grid;
+	if (!grid.needs_rebuild)
+	{
+		HighEntitySet& high_entities = game_state.high_entities;
+		if (grid.bucket[high_index] != HIGH_ENTITY_GRID_NO_BUCKET)
+		{
+			RemoveFromHighEntityGrid(grid, high_index);
+		}
+		if (large_grid.bucket[high_index] != HIGH_ENTITY_GRID_NO_BUCKET)
+		{
+			RemoveFromHighEntityGrid(large_grid, high_index);
+		}
+		if (game_state.low_entities[GetHighLowIndex(high_entities, high_index)].moves)
+		{
+			u32 mover_slot = grid.mover_slot[high_index];
+			u32 last_mover = grid.movers[--grid.mover_count];
+			grid.movers[mover_slot] = last_mover;
+			grid.mover_slot[last_mover] = mover_slot;
+		}
+
+		if (high_index != last_high_index)
+		{
+			MoveHighEntityGridLink(grid, high_index, last_high_index);
+			MoveHighEntityGridLink(large_grid, high_index, last_high_index);
+			if (game_state.low_entities[GetHighLowIndex(high_entities, last_high_index)].moves)
+			{
+				u32 mover_slot = grid.mover_slot[last_high_index];
+				grid.movers[mover_slot] = high_index;
+				grid.mover_slot[high_index] = mover_slot;
+			}
+		}
+	}
+}
+
+internal_static void RebuildHighEntityGrid(GameState& game_state)
+{
+	HighEntitySet& high_entities = game_state.high_entities;
+	Assert(high_entities.count <= game_state.high_entity_grid.max_count && high_entities.count <= game_state.large_collider_grid.max_count);
+
+	ClearHighEntityGrid(game_state.high_entity_grid);
+	ClearHighEntityGrid(game_state.large_collider_grid);
+	for (u32 high_index = 1; high_index < high_entities.count; ++high_index)
+	{
+		LinkHighEntityIntoGrids(game_state, high_index);
+	}
+}
+
+inline u32 MakeEntityHighFrequency(GameState& game_state, u32 low_index)
+{
+	u32 high_index = 0;
+
+	HighEntitySet& high_entities = game_state.high_entities;
+	LowEntity& low_entity = game_state.low_entities[low_index];
+	if (low_entity.high_entity_index)
+	{
+		high_index = low_entity.high_entity_index;
+	}
+	else
+	{
+		if (ReserveHighEntities(high_entities, high_entities.count + 1))
+		{
+			high_index = high_entities.count++;
+			HighEntitySlot slot = GetHighEntitySlot(high_entities, high_index);
+
+			//Note: the slot may still hold a demoted entity's columns, every one of them is written here
+			WorldDifference difference = Subtract(*(game_state.world), low_entity.position, game_state.camera_position);
+			slot.block->position_x[slot.index] = difference.delta_xy.x;
+			slot.block->position_y[slot.index] = difference.delta_xy.y;
+			slot.block->z[slot.index] = 0;
+			slot.block->delta_z[slot.index] = 0;
+			slot.block->velocity[slot.index] = {};
+			slot.block->acceleration[slot.index] = {};
+			slot.block->previous_offset[slot.index] = {};
+			slot.block->tile_z[slot.index] = low_entity.position.tile_z;
+			slot.block->facing_direction[slot.index] = 0;
+			slot.block->low_entity_index[slot.index] = low_index;
+
+			low_entity.high_entity_index = high_index;
+			LinkHighEntityIntoGrids(game_state, high_index);
+			if (!low_entity.moves)
+			{
+				++game_state.static_layer_version;
+			}
+		}
+		else
+		{
+			InvalidCodePath();
+		}
+	}
+
+	return high_index;
+}
+
+//Note: swap-removes from the high set, the last entity takes over the slot and its low entity is pointed at it
+inline void MakeEntityLowFrequency(GameState& game_state, u32 low_index)
+{
+	LowEntity& low_entity = game_state.low_entities[low_index];
+	u32 high_index = low_entity.high_entity_index;
+	if (high_index)
+	{
+		HighEntitySet& high_entities = game_state.high_entities;
+		u32 last_high_index = high_entities.count - 1;
+		UnlinkHighEntityFromGrids(game_state, high_index, last_high_index);
+		if (high_index != last_high_index)
+		{
+			CopyHighEntity(high_entities, high_index, last_high_index);
+			game_state.low_entities[GetHighLowIndex(high_entities, high_index)].high_entity_index = high_index;
+		}
+		--high_entities.count;
+		low_entity.high_entity_index = 0;
+		if (!low_entity.moves)
+		{
+			++game_state.static_layer_version;
+		}
+	}
+}
+
+internal_static Entity GetHighEntity(GameState& game_state, u32 low_index)
+{
+	Entity result{};
+
+	if (low_index > 0 && low_index < game_state.low_entity_count)
+	{
+		result.low_index = low_index;
+		result.low = game_state.low_entities + low_index;
+		result.high_index = MakeEntityHighFrequency(game_state, low_index);
+	}
+
+	return result;
+}
+
+internal_static Entity GetHighEntity(GameState& game_state, EntityHandle handle)
+{
+	Entity result{};
+
+	if (IsEntityHandleValid(game_state, handle))
+	{
+		result = GetHighEntity(game_state, handle.index);
+	}
+
+	return result;
+}
+
+internal_static void InitializeEntityResidency(EntityResidency& residency, MemoryArena& arena, u32 candidate_capacity)
+{
+	residency = {};
+	residency.candidate_capacity = candidate_capacity;
+	residency.candidates = PushArray(arena, candidate_capacity, ResidencyCandidate, ArenaTag_HighEntity, NoClear());
+	residency.sort_temp = PushArray(arena, candidate_capacity, ResidencyCandidate, ArenaTag_HighEntity, NoClear());
+	residency.needs_rescan = true;
+	residency.scan_min_tile_x = 1;
+	residency.scan_max_tile_x = 0;
+}
+
+struct ResidencyBudget
+{
+	u64 start_microseconds;
+	u32 spent_count;
+	b32 exhausted;
+};
+
+internal_static ResidencyBudget BeginResidencyBudget()
+{
+	ResidencyBudget result{};
+	if (global_platform_get_wall_clock)
+	{
+		result.start_microseconds = global_platform_get_wall_clock();
+	}
+	return result;
+}
+
+//Note: spends one entity worth of work, false once the frame is out of budget and stays false for the rest of it.
+//Only entities are counted, never time, so a replayed input loop promotes the same entities on the same ticks
+internal_static b32 SpendResidencyBudget(EntityResidency& residency, ResidencyBudget& budget)
+{
+	if (!budget.exhausted && budget.spent_count >= residency.budget_count)
+	{
+		budget.exhausted = true;
+	}
+
+	if (!budget.exhausted)
+	{
+		++budget.spent_count;
+	}
+
+	return !budget.exhausted;
+}
+
+//Note: lsd radix sort on the key bits, a non negative float orders the same as its bit pattern
+internal_static void SortResidencyCandidates(ResidencyCandidate* candidates, ResidencyCandidate* temp, u32 count)
+{
+	ResidencyCandidate* source = candidates;
+	ResidencyCandidate* dest = temp;
+	for (u32 byte_index = 0; byte_index < 4; ++byte_index)
+	{
+		u32 shift = byte_index * 8;
+		u32 offsets[256] = {};
+		for (u32 index = 0; index < count; ++index)
+		{
+			u32 key = FloatBits(source[index].distance_squared);
+			++offsets[(key >> shift) & 0xFF];
+		}
+
+		u32 total = 0;
+		for (u32 bucket = 0; bucket < ArrayCount(offsets); ++bucket)
+		{
+			u32 bucket_count = offsets[bucket];
+			offsets[bucket] = total;
+			total += bucket_count;
+		}
+
+		for (u32 index = 0; index < count; ++index)
+		{
+			u32 key = FloatBits(source[index].distance_squared);
+			dest[offsets[(key >> shift) & 0xFF]++] = source[index];
+		}
+
+		ResidencyCandidate* swap = source;
+		source = dest;
+		dest = swap;
+	}
+
+	//Note: an even number of passes leaves the result back in candidates
+}
+
+//Note: queues every low entity in the tile rectangle that is not high yet, nearest to focus first
+internal_static void QueueResidencyCandidates(GameState& game_state, i32 min_tile_x, i32 min_tile_y, i32 max_tile_x, i32 max_tile_y, V2 focus)
+{
+	World& world = *(game_state.world);
+	EntityResidency& residency = game_state.residency;
+
+	residency.candidate_count = 0;
+	residency.next_candidate = 0;
+	residency.needs_rescan = false;
+	residency.scan_min_tile_x = min_tile_x;
+	residency.scan_min_tile_y = min_tile_y;
+	residency.scan_max_tile_x = max_tile_x;
+	residency.scan_max_tile_y = max_tile_y;
+	residency.scan_tile_z = game_state.camera_position.tile_z;
+
+	//Note: only the chunks overlapping the span are visited, they reach past it so the tile test stays
+	i32 min_chunk_x = min_tile_x >> world.chunk_shift;
+	i32 min_chunk_y = min_tile_y >> world.chunk_shift;
+	i32 max_chunk_x = max_tile_x >> world.chunk_shift;
+	i32 max_chunk_y = max_tile_y >> world.chunk_shift;
+
+	for (i32 chunk_y = min_chunk_y; chunk_y <= max_chunk_y; ++chunk_y)
+	{
+		for (i32 chunk_x = min_chunk_x; chunk_x <= max_chunk_x; ++chunk_x)
+		{
+			WorldChunk* chunk = GetTileChunk(world, chunk_x, chunk_y, game_state.camera_position.tile_z);
+			if (chunk)
+			{
+				for (WorldEntityBlock* block = &chunk->first_block; block; block = block->next)
+				{
+					for (u32 entity_index_in_block = 0; entity_index_in_block < block->entity_count; ++entity_index_in_block)
+					{
+						u32 low_index = block->low_entity_index[entity_index_in_block];
+						LowEntity& low_entity = game_state.low_entities[low_index];
+
+						if (low_entity.high_entity_index == 0 && !low_entity.merged_wall.index)
+						{
+							if (low_entity.position.tile_x >= min_tile_x &&
+								low_entity.position.tile_x <= max_tile_x &&
+								low_entity.position.tile_y >= min_tile_y &&
+								low_entity.position.tile_y <= max_tile_y)
+							{
+								if (residency.candidate_count < residency.candidate_capacity)
+								{
+									WorldDifference difference = Subtract(world, low_entity.position, game_state.camera_position);
+
+									ResidencyCandidate& candidate = residency.candidates[residency.candidate_count++];
+									candidate.low_index = low_index;
+									candidate.distance_squared = LengthSquared(difference.delta_xy - focus);
+								}
+								else
+								{
+									//Note: picked up by another rescan once this queue is drained
+									residency.needs_rescan = true;
+								}
+							}
+						}
+					}
+				}
+			}
+		}
+	}
+
+	SortResidencyCandidates(residency.candidates, residency.sort_temp, residency.candidate_count);
+	residency.frame_stats.queued_count += residency.candidate_count;
+}
+
+internal_static void PromoteQueuedEntities(GameState& game_state, ResidencyBudget& budget)
+{
+	EntityResidency& residency = game_state.residency;
+	r32 required_radius_squared = Square(residency.required_radius);
+
+	while (residency.next_candidate < residency.candidate_count)
+	{
+		ResidencyCandidate& candidate = residency.candidates[residency.next_candidate];
+		if (candidate.distance_squared > required_radius_squared && !SpendResidencyBudget(residency, budget))
+		{
+			break;
+		}
+		++residency.next_candidate;
+
+		//Note: the entity may have been deleted or promoted on demand since it was queued
+		LowEntity& low_entity = game_state.low_entities[candidate.low_index];
+		if (low_entity.type != EntityType_Null && low_entity.high_entity_index == 0)
+		{
+			MakeEntityHighFrequency(game_state, candidate.low_index);
+			++residency.frame_stats.promoted_count;
+		}
+	}
+}
+
+//Note: first_index comes from OffsetHighEntities and is never slot 0. A demoted entity is replaced by the last one, which was already
+//offset, so the same slot is tested again. Whatever the budget leaves is found again next frame
+internal_static void DemoteEntitiesOutside(GameState& game_state, u32 first_index, Rectangle high_frequency_bounds, ResidencyBudget& budget)
+{
+	HighEntitySet& high_entities = game_state.high_entities;
+
+	Assert(first_index > 0);
+	for (u32 high_index = first_index; high_index < high_entities.count;)
+	{
+		if (IsInRectangle(high_frequency_bounds, GetHighPosition(high_entities, high_index)))
+		{
+			++high_index;
+		}
+		else if (SpendResidencyBudget(game_state.residency, budget))
+		{
+			MakeEntityLowFrequency(game_state, GetHighLowIndex(high_entities, high_index));
+			++game_state.residency.frame_stats.demoted_count;
+		}
+		else
+		{
+			break;
+		}
+	}
+}
+
+//Note: every high entity points back at a low entity that points at it, and no other low entity claims a high slot
+internal_static u32 Debug_CountHighEntityIndexErrors(GameState& game_state)
+{
+	u32 error_count = 0;
+
+	HighEntitySet& high_entities = game_state.high_entities;
+	for (u32 high_index = 1; high_index < high_entities.count; ++high_index)
+	{
+		u32 low_index = GetHighLowIndex(high_entities, high_index);
+		if (low_index == 0 || low_index >= game_state.low_entity_count ||
+			game_state.low_entities[low_index].high_entity_index != high_index)
+		{
+			++error_count;
+		}
+	}
+
+	for (u32 low_index = 1; low_index < game_state.low_entity_count; ++low_index)
+	{
+		u32 high_index = game_state.low_entities[low_index].high_entity_index;
+		if (high_index && (high_index >= high_entities.count || GetHighLowIndex(high_entities, high_index) != low_index))
+		{
+			++error_count;
+		}
+	}
+
+	return error_count;
+}
+
+struct Debug_HighEntityStressResult
+{
+	u32 frame_count;
+	u32 promoted_count;
+	u32 demoted_count;
+	u32 peak_high_count;
+	u32 index_error_count; //Note: summed over every frame
+};
+
+//Note: promotes entity_count low entities and demotes a shifting half of them every frame, checking the
+//index invariants after each frame. Everything it promoted is demoted again before returning
+internal_static Debug_HighEntityStressResult Debug_StressHighEntitySet(GameState& game_state, u32 entity_count, u32 frame_count)
+{
+	Debug_HighEntityStressResult result{};
+	result.frame_count = frame_count;
+
+	Assert(entity_count < game_state.low_entity_count);
+	u32 first_low_index = game_state.low_entity_count - entity_count;
+
+	for (u32 frame_index = 0; frame_index < frame_count; ++frame_index)
+	{
+		for (u32 entity_offset = 0; entity_offset < entity_count; ++entity_offset)
+		{
+			u32 low_index = first_low_index + entity_offset;
+			if (!game_state.low_entities[low_index].high_entity_index)
+			{
+				MakeEntityHighFrequency(game_state, low_index);
+				++result.promoted_count;
+			}
+		}
+
+		result.peak_high_count = Maximum(result.peak_high_count, game_state.high_entities.count);
+
+		//Note: the demoted half changes every frame, so removal hits the middle, the end and the block boundaries
+		for (u32 entity_offset = 0; entity_offset < entity_count; ++entity_offset)
+		{
+			u32 low_index = first_low_index + entity_offset;
+			if (((entity_offset * 7 + frame_index) % 2) == 0)
+			{
+				MakeEntityLowFrequency(game_state, low_index);
+				++result.demoted_count;
+			}
+		}
+
+		result.index_error_count += Debug_CountHighEntityIndexErrors(game_state);
+	}
+
+	for (u32 entity_offset = 0; entity_offset < entity_count; ++entity_offset)
+	{
+		u32 low_index = first_low_index + entity_offset;
+		if (game_state.low_entities[low_index].high_entity_index)
+		{
+			MakeEntityLowFrequency(game_state, low_index);
+			++result.demoted_count;
+		}
+	}
+
+	result.index_error_count += Debug_CountHighEntityIndexErrors(game_state);
+
+	return result;
+}
+
+//Note: the array of structs layout the high set used before it was split into columns, kept for the comparison below
+struct Debug_HighEntityAoS
+{
+	V2 position;
+	V2 velocity;
+	i32 tile_z;
+	u32 facing_direction;
+
+	r32 z;
+	r32 delta_z;
+
+	u32 low_entity_index;
+};
+
+struct Debug_HighEntityLayoutResult
+{
+	u32 entity_count;
+	u32 iteration_count;
+
+	u64 aos_cycles;
+	u64 soa_cycles;
+
+	u32 mismatch_count; //Note: entities whose z or position differ between the two layouts
+};
+
+//Note: runs the z integration and the camera offset/bounds pass over both layouts with the same data.
+//Everything lives in a temporary block of the given arena
+internal_static Debug_HighEntityLayoutResult Debug_BenchmarkHighEntityLayouts(MemoryArena& arena, u32 entity_count, u32 iteration_count)
+{
+	Debug_HighEntityLayoutResult result{};
+	result.entity_count = entity_count;
+	result.iteration_count = iteration_count;
+
+	TemporaryMemory temp_memory = BeginTemporaryMemory(arena);
+
+	Debug_HighEntityAoS* aos = PushArray(arena, entity_count, Debug_HighEntityAoS, ArenaTag_FrameScratch, Align(CACHE_LINE_SIZE, true));
+	HighEntitySet soa{};
+	InitializeHighEntitySet(soa, arena, entity_count);
+	ReserveHighEntities(soa, entity_count);
+	soa.count = entity_count;
+
+	for (u32 entity_index = 0; entity_index < entity_count; ++entity_index)
+	{
+		V2 position{ static_cast<r32>(entity_index % 51) - 25.f, static_cast<r32>(entity_index % 27) - 13.f };
+		r32 delta_z = (entity_index % 3 == 0) ? 3.f : 0.f;
+
+		aos[entity_index].position = position;
+		aos[entity_index].delta_z = delta_z;
+		SetHighPosition(soa, entity_index, position);
+		HighEntitySlot slot = GetHighEntitySlot(soa, entity_index);
+		slot.block->delta_z[slot.index] = delta_z;
+	}
+
+	r32 dt = 1.f / 30.f;
+	r32 gravity = -9.8f;
+	Rectangle bounds = RectCenterDim(V2{}, V2{ 100.f, 100.f });
+	u32 outside_count = 0;
+
+	u64 start_cycle_count = __rdtsc();
+	for (u32 iteration = 0; iteration < iteration_count; ++iteration)
+	{
+		V2 offset = (iteration & 1) ? V2{ 0.25f, -0.5f } : V2{ -0.25f, 0.5f };
+
+		for (u32 entity_index = 0; entity_index < entity_count; ++entity_index)
+		{
+			Debug_HighEntityAoS& high_entity = aos[entity_index];
+			high_entity.z += 0.5f * gravity * Square(dt) + high_entity.delta_z * dt;
+			high_entity.delta_z += gravity * dt;
+			if (high_entity.z < 0)
+			{
+				high_entity.z = 0;
+			}
+		}
+
+		for (u32 entity_index = 0; entity_index < entity_count; ++entity_index)
+		{
+			Debug_HighEntityAoS& high_entity = aos[entity_index];
+			high_entity.position += offset;
+			if (!IsInRectangle(bounds, high_entity.position))
+			{
+				++outside_count;
+			}
+		}
+	}
+	result.aos_cycles = __rdtsc() - start_cycle_count;
+
+	start_cycle_count = __rdtsc();
+	for (u32 iteration = 0; iteration < iteration_count; ++iteration)
+	{
+		V2 offset = (iteration & 1) ? V2{ 0.25f, -0.5f } : V2{ -0.25f, 0.5f };
+
+		IntegrateHighEntityZ(soa, dt, gravity);
+		outside_count += OffsetHighEntities(soa, offset, bounds) != soa.count;
+	}
+	result.soa_cycles = __rdtsc() - start_cycle_count;
+
+	for (u32 entity_index = 0; entity_index < entity_count; ++entity_index)
+	{
+		V2 position = GetHighPosition(soa, entity_index);
+		HighEntitySlot slot = GetHighEntitySlot(soa, entity_index);
+		if (aos[entity_index].z != slot.block->z[slot.index] ||
+			aos[entity_index].position.x != position.x ||
+			aos[entity_index].position.y != position.y)
+		{
+			++result.mismatch_count;
+		}
+	}
+	Assert(outside_count == 0);
+
+	EndTemporaryMemory(temp_memory);
+
+	return result;
+}
+
+//Note: reuses the most recently freed slot before growing low_entity_count
+internal_static EntityHandle AddLowEntity(GameState& game_state, EntityType type)
+{
+	u32 entity_index = game_state.first_free_low_entity;
+	if (entity_index)
+	{
+		game_state.first_free_low_entity = game_state.low_entities[entity_index].next_free_index;
+		--game_state.free_low_entity_count;
+	}
+	else
+	{
+		Assert(game_state.low_entity_count < ArrayCount(game_state.low_entities));
+		entity_index = game_state.low_entity_count++;
+	}
+
+	LowEntity& entity = game_state.low_entities[entity_index];
+	u32 generation = entity.generation ? entity.generation : 1;
+
+	entity = {};
+	entity.type = type;
+	entity.generation = generation;
+
+	EntityHandle result;
+	result.index = entity_index;
+	result.generation = generation;
+	return result;
+}
+
+//Note: puts a new low entity into the chunk of its position. Only an entity inside the span of the last rescan is
+//missing from the residency queue, anything outside is queued by the rescan the camera triggers when it gets there
+internal_static void PlaceLowEntity(GameState& game_state, u32 low_index)
+{
+	LowEntity& entity = game_state.low_entities[low_index];
+	ChangeEntityLocation(*game_state.world, low_index, nullptr, &entity.position);
+
+	EntityResidency& residency = game_state.residency;
+	if (entity.position.tile_z == residency.scan_tile_z &&
+		entity.position.tile_x >= residency.scan_min_tile_x &&
+		entity.position.tile_x <= residency.scan_max_tile_x &&
+		entity.position.tile_y >= residency.scan_min_tile_y &&
+		entity.position.tile_y <= residency.scan_max_tile_y)
+	{
+		residency.needs_rescan = true;
+	}
+}
+
+//Note: takes the entity out of the high set and its chunk, then frees the slot. Stale handles are ignored
+internal_static void DeleteLowEntity(GameState& game_state, EntityHandle handle)
+{
+	if (IsEntityHandleValid(game_state, handle))
+	{
+		u32 low_index = handle.index;
+		MakeEntityLowFrequency(game_state, low_index);
+
+		LowEntity& entity = game_state.low_entities[low_index];
+		ChangeEntityLocation(*game_state.world, low_index, &entity.position, nullptr);
+
+		u32 generation = entity.generation + 1;
+		entity = {};
+		entity.generation = generation ? generation : 1;
+		entity.next_free_index = game_state.first_free_low_entity;
+
+		game_state.first_free_low_entity = low_index;
+		++game_state.free_low_entity_count;
+	}
+}
+
+internal_static EntityHandle AddWall(GameState& game_state, i32 tile_x, i32 tile_y, i32 tile_z)
 {
-	u32 low_index = AddLowEntity(game_state, EntityType_Wall);
-	LowEntity* entity = GetLowEntity(game_state, low_index);
+	EntityHandle handle = AddLowEntity(game_state, EntityType_Wall);
+	LowEntity* entity = GetLowEntity(game_state, handle);
 	entity->position.tile_x = tile_x;
 	entity->position.tile_y = tile_y;
 	entity->position.tile_z = tile_z;
@@ -426,13 +2981,107 @@ internal_static u32 AddWall(GameState& game_state, i32 tile_x, i32 tile_y, i32 t
 	entity->width = entity->height;
 	entity->collides = true;
 
-	return low_index;
+	PlaceLowEntity(game_state, handle.index);
+
+	return handle;
+}
+
+//Note: covers the wall tiles of one chunk with greedy maximal rectangles, widest run first then as far down as it
+//stays full. Runs of a single tile are left alone. The tiles stay for gameplay, collision and drawing go to the rect
+internal_static void MergeWallsInChunk(GameState& game_state, WorldChunk& chunk)
+{
+	World& world = *game_state.world;
+	r32 tile_side = world.tile_side_in_meters;
+
+	constexpr i32 MAX_CHUNK_DIMENSION = 32;
+	Assert(world.chunk_dimension <= MAX_CHUNK_DIMENSION);
+
+	u32 rows[MAX_CHUNK_DIMENSION] = {};
+	u32 tile_low_index[MAX_CHUNK_DIMENSION][MAX_CHUNK_DIMENSION];
+	for (WorldEntityBlock* block = &chunk.first_block; block; block = block->next)
+	{
+		for (u32 entity_index_in_block = 0; entity_index_in_block < block->entity_count; ++entity_index_in_block)
+		{
+			u32 low_index = block->low_entity_index[entity_index_in_block];
+			LowEntity& low_entity = game_state.low_entities[low_index];
+			if (low_entity.type == EntityType_Wall && low_entity.collides &&
+				low_entity.position.offset_.x == 0.f && low_entity.position.offset_.y == 0.f)
+			{
+				i32 tile_x = low_entity.position.tile_x & world.chunk_mask;
+				i32 tile_y = low_entity.position.tile_y & world.chunk_mask;
+				rows[tile_y] |= 1u << tile_x;
+				tile_low_index[tile_y][tile_x] = low_index;
+			}
+		}
+	}
+
+	for (i32 min_y = 0; min_y < world.chunk_dimension; ++min_y)
+	{
+		while (rows[min_y])
+		{
+			i32 min_x = static_cast<i32>(FindLeastSignificantSetBit(rows[min_y]).index);
+			i32 width = 1;
+			while (min_x + width < world.chunk_dimension && (rows[min_y] & (1u << (min_x + width))))
+			{
+				++width;
+			}
+
+			u32 run_mask = ((width == 32) ? 0xFFFFFFFFu : ((1u << width) - 1)) << min_x;
+			i32 height = 1;
+			while (min_y + height < world.chunk_dimension && (rows[min_y + height] & run_mask) == run_mask)
+			{
+				++height;
+			}
+
+			for (i32 y = min_y; y < min_y + height; ++y)
+			{
+				rows[y] &= ~run_mask;
+			}
+
+			if (width * height > 1)
+			{
+				//Note: added after the chunk was walked, the new entity may land in this chunk's blocks
+				WorldPosition base = game_state.low_entities[tile_low_index[min_y][min_x]].position;
+				EntityHandle handle = AddLowEntity(game_state, EntityType_WallRect);
+				LowEntity* rect = GetLowEntity(game_state, handle);
+				rect->position = MapIntoTileSpace(world, base, V2{ static_cast<r32>(width - 1), static_cast<r32>(height - 1) } * (0.5f * tile_side));
+				rect->width = static_cast<r32>(width) * tile_side;
+				rect->height = static_cast<r32>(height) * tile_side;
+				rect->collides = true;
+				PlaceLowEntity(game_state, handle.index);
+
+				for (i32 y = min_y; y < min_y + height; ++y)
+				{
+					for (i32 x = min_x; x < min_x + width; ++x)
+					{
+						LowEntity& tile = game_state.low_entities[tile_low_index[y][x]];
+						Assert(!tile.high_entity_index);
+						tile.merged_wall = handle;
+						tile.collides = false;
+					}
+				}
+			}
+		}
+	}
+}
+
+//Note: once the world is generated. Rects stop at chunk edges, so they stay well inside the residency prefetch margin
+internal_static void MergeStaticWalls(GameState& game_state)
+{
+	World& world = *game_state.world;
+	for (u32 hash_index = 0; hash_index < ArrayCount(world.tile_chunk_hash); ++hash_index)
+	{
+		for (WorldChunk* chunk = world.tile_chunk_hash[hash_index]; chunk; chunk = chunk->next_in_hash)
+		{
+			MergeWallsInChunk(game_state, *chunk);
+		}
+	}
 }
 
-internal_static u32 AddPlayer(GameState& game_state)
+internal_static EntityHandle AddPlayer(GameState& game_state)
 {
-	u32 low_index = AddLowEntity(game_state, EntityType_Hero);
-	LowEntity* entity = GetLowEntity(game_state, low_index);
+	EntityHandle handle = AddLowEntity(game_state, EntityType_Hero);
+	LowEntity* entity = GetLowEntity(game_state, handle);
 	entity->position.tile_x = 2;
 	entity->position.tile_y = 2;
 	entity->position.offset_ = { .5f , .5f };
@@ -440,15 +3089,83 @@ internal_static u32 AddPlayer(GameState& game_state)
 	entity->height = 0.5f;//1.4f;
 	entity->width = 1.0f;// entity->height * 0.75f;
 	entity->collides = true;
+	entity->moves = true;
+
+	PlaceLowEntity(game_state, handle.index);
 
 	//MakeEntityHighFrequency(game_state, low_index);
 
-	if (game_state.camera_follow_entity_index == 0)
+	if (!IsEntityHandleValid(game_state, game_state.camera_follow_entity))
 	{
-		game_state.camera_follow_entity_index = low_index;
+		game_state.camera_follow_entity = handle;
 	}
 
-	return low_index;
+	return handle;
+}
+
+struct Debug_EntitySpawnSoakResult
+{
+	u32 spawned_count;
+	u32 deleted_count;
+	u32 stale_handle_count; //Note: deleted handles that were still reported valid
+	u32 low_entity_count_after_first_frame;
+	u32 low_entity_count_at_end;
+	u32 leaked_slot_count; //Note: slots past the first frame's, freed ones were not reused
+};
+
+//Note: soak test for spawn/despawn heavy content, every frame deletes the walls spawned the frame before and spawns
+//as many new ones far away from the rooms. low_entity_count has to stay flat once the free list is primed
+internal_static Debug_EntitySpawnSoakResult Debug_SoakEntitySpawns(GameState& game_state, u32 frame_count)
+{
+	Debug_EntitySpawnSoakResult result{};
+
+	EntityHandle live[256] = {};
+	for (u32 frame_index = 0; frame_index < frame_count; ++frame_index)
+	{
+		for (u32 live_index = 0; live_index < ArrayCount(live); ++live_index)
+		{
+			EntityHandle old_handle = live[live_index];
+			if (old_handle.index)
+			{
+				DeleteLowEntity(game_state, old_handle);
+				++result.deleted_count;
+
+				if (IsEntityHandleValid(game_state, old_handle))
+				{
+					++result.stale_handle_count;
+				}
+			}
+
+			i32 tile_x = -100000 + static_cast<i32>((frame_index * 7 + live_index) % 64);
+			i32 tile_y = -100000 + static_cast<i32>(live_index / 4);
+			live[live_index] = AddWall(game_state, tile_x, tile_y, 0);
+			++result.spawned_count;
+
+			if (IsEntityHandleValid(game_state, old_handle))
+			{
+				++result.stale_handle_count;
+			}
+		}
+
+		if (frame_index == 0)
+		{
+			result.low_entity_count_after_first_frame = game_state.low_entity_count;
+		}
+	}
+
+	for (u32 live_index = 0; live_index < ArrayCount(live); ++live_index)
+	{
+		DeleteLowEntity(game_state, live[live_index]);
+		++result.deleted_count;
+	}
+
+	result.low_entity_count_at_end = game_state.low_entity_count;
+	if (frame_count > 1 && result.low_entity_count_at_end > result.low_entity_count_after_first_frame + 1)
+	{
+		result.leaked_slot_count = result.low_entity_count_at_end - result.low_entity_count_after_first_frame - 1;
+	}
+
+	return result;
 }
 
 internal_static b32 TestWall(r32 wall_x, r32 relative_x, r32 relative_y, r32 player_delta_x, r32 player_delta_y, r32& min_time, r32 min_y, r32 max_y)
@@ -473,9 +3190,188 @@ internal_static b32 TestWall(r32 wall_x, r32 relative_x, r32 relative_y, r32 pla
 	return hit;
 }
 
-internal_static void MovePlayer(GameState& game_state, Entity& entity, r32 delta_time, V2 acceleration)
+//Note: the reference the simd path is checked against, walls in the order the movers always tested them
+internal_static void CollideMoverScalar(const CollisionCandidates& candidates, V2 position, V2 player_delta, MoverCollision& collision)
 {
-	World& world = *game_state.world;
+	for (u32 candidate_index = 0; candidate_index < candidates.count; ++candidate_index)
+	{
+		V2 min_corner{ candidates.min_corner_x[candidate_index], candidates.min_corner_y[candidate_index] };
+		V2 max_corner{ candidates.max_corner_x[candidate_index], candidates.max_corner_y[candidate_index] };
+		V2 relative_position = position - V2{ candidates.position_x[candidate_index], candidates.position_y[candidate_index] };
+		u32 test_high_index = candidates.high_index[candidate_index];
+
+		if (TestWall(min_corner.x, relative_position.x, relative_position.y, player_delta.x, player_delta.y, collision.min_time, min_corner.y, max_corner.y))
+		{
+			collision.wall_normal = V2{ -1, 0 };
+			collision.hit_high_index = test_high_index;
+		}
+		if (TestWall(max_corner.x, relative_position.x, relative_position.y, player_delta.x, player_delta.y, collision.min_time, min_corner.y, max_corner.y))
+		{
+			collision.wall_normal = V2{ 1, 0 };
+			collision.hit_high_index = test_high_index;
+		}
+		if (TestWall(min_corner.y, relative_position.y, relative_position.x, player_delta.y, player_delta.x, collision.min_time, min_corner.x, max_corner.x))
+		{
+			collision.wall_normal = V2{ 0, -1 };
+			collision.hit_high_index = test_high_index;
+		}
+		if (TestWall(max_corner.y, relative_position.y, relative_position.x, player_delta.y, player_delta.x, collision.min_time, min_corner.x, max_corner.x))
+		{
+			collision.wall_normal = V2{ 0, 1 };
+			collision.hit_high_index = test_high_index;
+		}
+	}
+}
+
+global_static const V2 collide_wall_normals[4] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+
+//Note: walks the lanes that can hit in candidate then wall order, the same order and the same compare as TestWall.
+//A hit only lowers min_time, so a lane that missed the min_time of the batch can be skipped
+internal_static void ResolveWallHits(const CollisionCandidates& candidates, u32 first_index, u32 any_hit_mask, const u32* wall_hit_masks, const r32 (*wall_times)[HIGH_ENTITY_LANE_WIDTH], MoverCollision& collision)
+{
+	r32 time_epsilon = 0.001f;
+	while (any_hit_mask)
+	{
+		u32 lane = FindLeastSignificantSetBit(any_hit_mask).index;
+		any_hit_mask &= any_hit_mask - 1;
+
+		for (u32 wall = 0; wall < ArrayCount(collide_wall_normals); ++wall)
+		{
+			r32 result_time = wall_times[wall][lane];
+			if ((wall_hit_masks[wall] & (1u << lane)) && result_time < collision.min_time)
+			{
+				collision.min_time = Maximum(0.f, result_time - time_epsilon);
+				collision.wall_normal = collide_wall_normals[wall];
+				collision.hit_high_index = candidates.high_index[first_index + lane];
+			}
+		}
+	}
+}
+
+#if defined(__AVX__)
+inline __m256 TestWall8x(__m256 wall, __m256 relative, __m256 relative_other, __m256 delta, __m256 delta_other, __m256 moving, __m256 min_time, __m256 min_other, __m256 max_other, __m256& result_time)
+{
+	result_time = _mm256_div_ps(_mm256_sub_ps(wall, relative), delta);
+	__m256 other = _mm256_add_ps(relative_other, _mm256_mul_ps(result_time, delta_other));
+
+	__m256 hit = _mm256_and_ps(moving,
+		_mm256_and_ps(_mm256_cmp_ps(result_time, _mm256_setzero_ps(), _CMP_GE_OQ), _mm256_cmp_ps(result_time, min_time, _CMP_LT_OQ)));
+	return _mm256_and_ps(hit, _mm256_and_ps(_mm256_cmp_ps(other, min_other, _CMP_GE_OQ), _mm256_cmp_ps(other, max_other, _CMP_LE_OQ)));
+}
+#endif
+
+//Note: TestWall for 4 colliders at once, without the min_time update
+inline __m128 TestWall4x(__m128 wall, __m128 relative, __m128 relative_other, __m128 delta, __m128 delta_other, __m128 moving, __m128 min_time, __m128 min_other, __m128 max_other, __m128& result_time)
+{
+	result_time = _mm_div_ps(_mm_sub_ps(wall, relative), delta);
+	__m128 other = _mm_add_ps(relative_other, _mm_mul_ps(result_time, delta_other));
+
+	__m128 hit = _mm_and_ps(moving, _mm_and_ps(_mm_cmpge_ps(result_time, _mm_setzero_ps()), _mm_cmplt_ps(result_time, min_time)));
+	return _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(other, min_other), _mm_cmple_ps(other, max_other)));
+}
+
+//Note: same result as CollideMoverScalar bit for bit, as long as the scalar multiply-add is not contracted into an fma.
+//Lanes with a zero delta divide by zero, the moving mask drops them like the scalar test does
+internal_static void CollideMoverWide(const CollisionCandidates& candidates, V2 position, V2 player_delta, MoverCollision& collision)
+{
+	alignas(32) r32 wall_times[4][HIGH_ENTITY_LANE_WIDTH];
+	u32 wall_hit_masks[4];
+	u32 index = 0;
+
+#if defined(__AVX__)
+	__m256 position_x_8x = _mm256_set1_ps(position.x);
+	__m256 position_y_8x = _mm256_set1_ps(position.y);
+	__m256 delta_x_8x = _mm256_set1_ps(player_delta.x);
+	__m256 delta_y_8x = _mm256_set1_ps(player_delta.y);
+	__m256 moving_x_8x = _mm256_cmp_ps(delta_x_8x, _mm256_setzero_ps(), _CMP_NEQ_UQ);
+	__m256 moving_y_8x = _mm256_cmp_ps(delta_y_8x, _mm256_setzero_ps(), _CMP_NEQ_UQ);
+
+	for (; index + 8 <= candidates.count; index += 8)
+	{
+		__m256 min_time_8x = _mm256_set1_ps(collision.min_time);
+		__m256 relative_x = _mm256_sub_ps(position_x_8x, _mm256_load_ps(candidates.position_x + index));
+		__m256 relative_y = _mm256_sub_ps(position_y_8x, _mm256_load_ps(candidates.position_y + index));
+		__m256 min_x = _mm256_load_ps(candidates.min_corner_x + index);
+		__m256 min_y = _mm256_load_ps(candidates.min_corner_y + index);
+		__m256 max_x = _mm256_load_ps(candidates.max_corner_x + index);
+		__m256 max_y = _mm256_load_ps(candidates.max_corner_y + index);
+
+		__m256 result_time[4];
+		__m256 hit[4];
+		hit[0] = TestWall8x(min_x, relative_x, relative_y, delta_x_8x, delta_y_8x, moving_x_8x, min_time_8x, min_y, max_y, result_time[0]);
+		hit[1] = TestWall8x(max_x, relative_x, relative_y, delta_x_8x, delta_y_8x, moving_x_8x, min_time_8x, min_y, max_y, result_time[1]);
+		hit[2] = TestWall8x(min_y, relative_y, relative_x, delta_y_8x, delta_x_8x, moving_y_8x, min_time_8x, min_x, max_x, result_time[2]);
+		hit[3] = TestWall8x(max_y, relative_y, relative_x, delta_y_8x, delta_x_8x, moving_y_8x, min_time_8x, min_x, max_x, result_time[3]);
+
+		u32 any_hit_mask = static_cast<u32>(_mm256_movemask_ps(_mm256_or_ps(_mm256_or_ps(hit[0], hit[1]), _mm256_or_ps(hit[2], hit[3]))));
+		if (any_hit_mask)
+		{
+			for (u32 wall = 0; wall < 4; ++wall)
+			{
+				_mm256_store_ps(wall_times[wall], result_time[wall]);
+				wall_hit_masks[wall] = static_cast<u32>(_mm256_movemask_ps(hit[wall]));
+			}
+			ResolveWallHits(candidates, index, any_hit_mask, wall_hit_masks, wall_times, collision);
+		}
+	}
+#endif
+
+	__m128 position_x_4x = _mm_set1_ps(position.x);
+	__m128 position_y_4x = _mm_set1_ps(position.y);
+	__m128 delta_x_4x = _mm_set1_ps(player_delta.x);
+	__m128 delta_y_4x = _mm_set1_ps(player_delta.y);
+	__m128 moving_x_4x = _mm_cmpneq_ps(delta_x_4x, _mm_setzero_ps());
+	__m128 moving_y_4x = _mm_cmpneq_ps(delta_y_4x, _mm_setzero_ps());
+
+	//Note: the lanes past count read the padding, the count mask drops them
+	for (; index < candidates.count; index += 4)
+	{
+		__m128 min_time_4x = _mm_set1_ps(collision.min_time);
+		__m128 relative_x = _mm_sub_ps(position_x_4x, _mm_load_ps(candidates.position_x + index));
+		__m128 relative_y = _mm_sub_ps(position_y_4x, _mm_load_ps(candidates.position_y + index));
+		__m128 min_x = _mm_load_ps(candidates.min_corner_x + index);
+		__m128 min_y = _mm_load_ps(candidates.min_corner_y + index);
+		__m128 max_x = _mm_load_ps(candidates.max_corner_x + index);
+		__m128 max_y = _mm_load_ps(candidates.max_corner_y + index);
+
+		__m128 result_time[4];
+		__m128 hit[4];
+		hit[0] = TestWall4x(min_x, relative_x, relative_y, delta_x_4x, delta_y_4x, moving_x_4x, min_time_4x, min_y, max_y, result_time[0]);
+		hit[1] = TestWall4x(max_x, relative_x, relative_y, delta_x_4x, delta_y_4x, moving_x_4x, min_time_4x, min_y, max_y, result_time[1]);
+		hit[2] = TestWall4x(min_y, relative_y, relative_x, delta_y_4x, delta_x_4x, moving_y_4x, min_time_4x, min_x, max_x, result_time[2]);
+		hit[3] = TestWall4x(max_y, relative_y, relative_x, delta_y_4x, delta_x_4x, moving_y_4x, min_time_4x, min_x, max_x, result_time[3]);
+
+		u32 count_mask = (candidates.count - index >= 4) ? 0xF : ((1u << (candidates.count - index)) - 1);
+		u32 any_hit_mask = static_cast<u32>(_mm_movemask_ps(_mm_or_ps(_mm_or_ps(hit[0], hit[1]), _mm_or_ps(hit[2], hit[3])))) & count_mask;
+		if (any_hit_mask)
+		{
+			for (u32 wall = 0; wall < 4; ++wall)
+			{
+				_mm_store_ps(wall_times[wall], result_time[wall]);
+				wall_hit_masks[wall] = static_cast<u32>(_mm_movemask_ps(hit[wall]));
+			}
+			ResolveWallHits(candidates, index, any_hit_mask, wall_hit_masks, wall_times, collision);
+		}
+	}
+}
+
+//Note: only reads the game state, so any number of movers can step at once against the positions the stage started with
+internal_static MoverStep StepMover(const GameState& game_state, u32 high_index, r32 delta_time, CollisionScratch& scratch)
+{
+	const HighEntitySet& high_entities = game_state.high_entities;
+	const HighEntityGrid& grid = game_state.high_entity_grid;
+	const LowEntity& low_entity = game_state.low_entities[GetHighLowIndex(high_entities, high_index)];
+	HighEntitySlot high = GetHighEntitySlot(high_entities, high_index);
+
+	MoverStep step{};
+	step.position = GetHighPosition(high_entities, high_index);
+	step.velocity = high.block->velocity[high.index];
+	step.tile_z = high.block->tile_z[high.index];
+	step.facing_direction = high.block->facing_direction[high.index];
+
+	V2& position = step.position;
+	V2& velocity = step.velocity;
+	V2 acceleration = high.block->acceleration[high.index];
 
 	auto acceleration_length_squared = LengthSquared(acceleration);
 	if (acceleration_length_squared > 1.0f)
@@ -488,220 +3384,732 @@ internal_static void MovePlayer(GameState& game_state, Entity& entity, r32 delta
 
 	acceleration *= player_speed;
 
-	acceleration -= 8.0f * entity.high->velocity;
+	acceleration -= 8.0f * velocity;
 
-	V2 old_position = entity.high->position;
+	V2 old_position = position;
 
 	//p' = 1/2 at^2 + vt + p
-	V2 player_delta = 0.5f * acceleration * Square(delta_time) + entity.high->velocity * delta_time;
+	V2 player_delta = 0.5f * acceleration * Square(delta_time) + velocity * delta_time;
 
 	//v' = at + v
-	entity.high->velocity = acceleration * delta_time + entity.high->velocity;
+	velocity = acceleration * delta_time + velocity;
 
 	V2 new_position = old_position + player_delta;
 
-		/*u32 min_tile_x = Minimum(old_position.x, new_position.x);
-	u32 min_tile_y = Minimum(old_position.y, new_position.y);
-	u32 max_tile_x = Maximum(old_position.x, new_position.x);
-	u32 max_tile_y = Maximum(old_position.y, new_position.y);
+	//Note: the slides of later iterations stay inside the box of the first move, so one gather covers all of them
+	Rectangle move_region = RectMinMax(
+		V2{ Minimum(old_position.x, new_position.x), Minimum(old_position.y, new_position.y) },
+		V2{ Maximum(old_position.x, new_position.x), Maximum(old_position.y, new_position.y) });
+	scratch.candidate_count = 0;
+	if (grid.debug_test_all)
+	{
+		for (u32 test_high_index = 1; test_high_index < high_entities.count; ++test_high_index)
+		{
+			scratch.candidates[scratch.candidate_count++] = test_high_index;
+		}
+	}
+	else
+	{
+		r32 mover_extent = Maximum(low_entity.width, low_entity.height);
+		const HighEntityGrid& large_grid = game_state.large_collider_grid;
+		GatherHighEntityCandidates(grid, GetHighEntityGridGatherRegion(grid, old_position, new_position, mover_extent), scratch);
+		GatherHighEntityCandidates(large_grid, GetHighEntityGridGatherRegion(large_grid, old_position, new_position, mover_extent), scratch);
+		SortHighEntityCandidates(scratch);
+	}
+
+	//Note: the colliders stay put while the mover moves, their corners are worked out once for all iterations
+	CollisionCandidates& candidates = scratch.collision_candidates;
+	candidates.count = 0;
+	for (u32 candidate_index = 0; candidate_index < scratch.candidate_count; ++candidate_index)
+	{
+		u32 test_high_index = scratch.candidates[candidate_index];
+		if (test_high_index != high_index)
+		{
+			const LowEntity* test_low = game_state.low_entities + GetHighLowIndex(high_entities, test_high_index);
+			if (test_low->collides)
+			{
+				r32 diameter_width = test_low->width + low_entity.width;
+				r32 diameter_height = test_low->height + low_entity.height;
+
+				V2 min_corner = -0.5f * V2{ diameter_width, diameter_height };
+				V2 max_corner = 0.5f * V2{ diameter_width, diameter_height };
+				V2 test_position = GetHighPosition(high_entities, test_high_index);
+
+				//Note: the grid cells are coarse, a merged wall rect pulls in every other one near it. Whatever the move
+				//box does not reach cannot be hit
+				if (grid.debug_test_all ||
+					(test_position.x + min_corner.x <= move_region.max.x + 0.01f && test_position.x + max_corner.x >= move_region.min.x - 0.01f &&
+					test_position.y + min_corner.y <= move_region.max.y + 0.01f && test_position.y + max_corner.y >= move_region.min.y - 0.01f))
+				{
+					u32 dest_index = candidates.count++;
+					candidates.high_index[dest_index] = test_high_index;
+					candidates.position_x[dest_index] = test_position.x;
+					candidates.position_y[dest_index] = test_position.y;
+					candidates.min_corner_x[dest_index] = min_corner.x;
+					candidates.min_corner_y[dest_index] = min_corner.y;
+					candidates.max_corner_x[dest_index] = max_corner.x;
+					candidates.max_corner_y[dest_index] = max_corner.y;
+				}
+			}
+		}
+	}
+
+	for (u32 iteration = 0; iteration < 4; ++iteration)
+	{
+		MoverCollision collision{};
+		collision.min_time = 1.0f;
+
+		V2 desired_position = position + player_delta;
+
+		if (grid.debug_scalar_narrowphase)
+		{
+			CollideMoverScalar(candidates, position, player_delta, collision);
+		}
+		else
+		{
+			CollideMoverWide(candidates, position, player_delta, collision);
+		}
+
+		position += collision.min_time * player_delta;
+		if (collision.hit_high_index)
+		{
+			V2 wall_normal = collision.wall_normal;
+			velocity = velocity - Inner(velocity, wall_normal) * wall_normal;
+			player_delta = desired_position - position;
+			player_delta = player_delta - Inner(player_delta, wall_normal) * wall_normal;
+
+			const LowEntity& hit_low = game_state.low_entities[GetHighLowIndex(high_entities, collision.hit_high_index)];
+			step.tile_z += static_cast<u32>(static_cast<i32>(step.tile_z) + hit_low.velocity_tile_z);
+		}
+		else
+		{
+			break;
+		}
+
+	}
+
+	if (velocity.x == 0.f && velocity.y == 0.f)
+	{
+		//Note: dont set facing when still
+	}
+	else if (AbsoluteValue(velocity.x) > AbsoluteValue(velocity.y))
+	{
+		if (velocity.x > 0)
+		{
+			step.facing_direction = 0;
+		}
+		else
+		{
+			step.facing_direction = 2;
+		}
+	}
+	else if (AbsoluteValue(velocity.x) < AbsoluteValue(velocity.y))
+	{
+		if (velocity.y > 0)
+		{
+			step.facing_direction = 1;
+		}
+		else
+		{
+			step.facing_direction = 3;
+		}
+	}
+
+	return step;
+}
+
+internal_static void CommitMoverStep(GameState& game_state, u32 high_index, const MoverStep& step)
+{
+	World& world = *game_state.world;
+	HighEntitySet& high_entities = game_state.high_entities;
+	HighEntitySlot high = GetHighEntitySlot(high_entities, high_index);
+
+	high.block->velocity[high.index] = step.velocity;
+	high.block->acceleration[high.index] = {};
+	high.block->previous_offset[high.index] = GetHighPosition(high_entities, high_index) - step.position;
+	high.block->tile_z[high.index] = step.tile_z;
+	high.block->facing_direction[high.index] = step.facing_direction;
+	SetHighPosition(high_entities, high_index, step.position);
+	UpdateHighEntityGridCell(game_state.high_entity_grid, high_index, step.position);
+	UpdateHighEntityGridCell(game_state.large_collider_grid, high_index, step.position);
+
+	u32 low_index = GetHighLowIndex(high_entities, high_index);
+	LowEntity& low_entity = game_state.low_entities[low_index];
+	WorldPosition new_low_position = MapIntoTileSpace(world, game_state.camera_position, step.position);
+	ChangeEntityLocation(world, low_index, &low_entity.position, &new_low_position);
+	low_entity.position = new_low_position;
+}
+
+internal_static PLATFORM_WORK_QUEUE_CALLBACK(DoMoverTask)
+{
+	MoverTask& task = *static_cast<MoverTask*>(data);
+	MoverScratchPool& pool = *task.scratch_pool;
+
+	u32 scratch_index = 0;
+	while (AtomicCompareExchangeU32(pool.in_use + scratch_index, 1, 0) != 0)
+	{
+		++scratch_index;
+		Assert(scratch_index < pool.count);
+	}
+
+	for (u32 mover_index = task.first_mover; mover_index < task.one_past_last_mover; ++mover_index)
+	{
+		task.steps[mover_index] = StepMover(*task.game_state, task.movers[mover_index].high_index, task.delta_time, pool.scratches[scratch_index]);
+	}
+
+	AtomicExchangeU32(pool.in_use + scratch_index, 0);
+}
+
+internal_static void SortMoverOrder(MoverOrder* movers, MoverOrder* temp, u32 count)
+{
+	MoverOrder* source = movers;
+	MoverOrder* dest = temp;
+	for (u32 byte_index = 0; byte_index < 4; ++byte_index)
+	{
+		u32 shift = byte_index * 8;
+		u32 offsets[256] = {};
+		for (u32 index = 0; index < count; ++index)
+		{
+			++offsets[(source[index].sort_key >> shift) & 0xFF];
+		}
 
-	u32 entity_tile_width = CeilToU32(entity.dormant->width / world.tile_side_in_meters);
-	u32 entity_tile_height = CeilToU32(entity.dormant->height / world.tile_side_in_meters);
+		u32 total = 0;
+		for (u32 bucket = 0; bucket < ArrayCount(offsets); ++bucket)
+		{
+			u32 bucket_count = offsets[bucket];
+			offsets[bucket] = total;
+			total += bucket_count;
+		}
 
-	min_tile_x -= entity_tile_width;
-	min_tile_y -= entity_tile_height;
-	max_tile_x += entity_tile_width;
-	max_tile_y += entity_tile_height;
+		for (u32 index = 0; index < count; ++index)
+		{
+			dest[offsets[(source[index].sort_key >> shift) & 0xFF]++] = source[index];
+		}
 
-	u32 tile_z = entity.dormant->position.tile_z;*/
+		MoverOrder* swap = source;
+		source = dest;
+		dest = swap;
+	}
 
-	//r32 remaining_time = 1.0f;
-	for (u32 iteration = 0; iteration < 4; ++iteration)
-	{
-		r32 min_time = 1.0f;
+	//Note: an even number of passes leaves the result back in movers
+}
 
-		V2 wall_normal{};
+//Note: acceleration, drag and collide-and-slide for every moving high entity. The movers are ordered by coarse cell and
+//split into tasks of neighbours, which step in parallel against the positions the stage started with, so a mover never
+//sees another mover's move from the same tick. The steps are written back in that same order on the calling thread
+internal_static void MoveEntities(GameState& game_state, r32 delta_time, MemoryArena& arena, PlatformWorkQueue* queue)
+{
+	BEGIN_TIMED_BLOCK(MoveEntities);
 
-		u32 hit_high_entity_index = 0;
+	HighEntityGrid& grid = game_state.high_entity_grid;
+	if (grid.needs_rebuild)
+	{
+		RebuildHighEntityGrid(game_state);
+	}
 
-		V2 desired_position = entity.high->position + player_delta;
+	u32 mover_count = grid.mover_count;
+	if (mover_count)
+	{
+		TemporaryMemory temp_memory = BeginTemporaryMemory(arena);
 
-		for (u32 test_high_index = 1; test_high_index < game_state.high_entity_count; ++test_high_index)
+		MoverOrder* movers = PushArray(arena, mover_count, MoverOrder, ArenaTag_FrameScratch, AlignNoClear(CACHE_LINE_SIZE));
+		MoverOrder* sort_temp = PushArray(arena, mover_count, MoverOrder, ArenaTag_FrameScratch, AlignNoClear(CACHE_LINE_SIZE));
+		MoverStep* steps = PushArray(arena, mover_count, MoverStep, ArenaTag_FrameScratch, AlignNoClear(CACHE_LINE_SIZE));
+		for (u32 mover_index = 0; mover_index < mover_count; ++mover_index)
 		{
-			if (test_high_index != entity.low->high_entity_index)
-			{
-				Entity test_entity;
-				test_entity.high = game_state.high_entities + test_high_index;
-				test_entity.low_index = test_entity.high->low_entity_index;
-				test_entity.low = game_state.low_entities + test_entity.low_index;
-				if (test_entity.low->collides)
-				{
-					r32 diameter_width = test_entity.low->width + entity.low->width;
-					r32 diameter_height = test_entity.low->width + entity.low->height;
-
-					V2 min_corner = -0.5f * V2{ diameter_width, diameter_height };
-					V2 max_corner = 0.5f * V2{ diameter_width, diameter_height };
+			u32 high_index = grid.movers[mover_index];
+			V2 position = GetHighPosition(game_state.high_entities, high_index);
+			u32 cell_x = static_cast<u32>(FloorToI32(position.x * grid.one_over_cell_side) >> MOVER_TASK_CELL_SHIFT);
+			u32 cell_y = static_cast<u32>(FloorToI32(position.y * grid.one_over_cell_side) >> MOVER_TASK_CELL_SHIFT);
+
+			//Note: the sort is stable, movers in the same cell keep their order in the mover list
+			movers[mover_index].sort_key = ((cell_y + 0x8000) & 0xFFFF) << 16 | ((cell_x + 0x8000) & 0xFFFF);
+			movers[mover_index].high_index = high_index;
+		}
+		SortMoverOrder(movers, sort_temp, mover_count);
 
-					V2 relative_position = entity.high->position - test_entity.high->position;
+		u32 task_count = Maximum(1u, Minimum(MOVER_TASK_MAX_COUNT, mover_count / MOVER_TASK_MIN_MOVER_COUNT));
+		if (!queue || !global_platform_add_work_entry || !global_platform_complete_all_work)
+		{
+			task_count = 1;
+		}
 
-					if (TestWall(min_corner.x, relative_position.x, relative_position.y, player_delta.x, player_delta.y, min_time, min_corner.y, max_corner.y))
-					{
-						wall_normal = V2{ -1, 0 };
-						hit_high_entity_index = test_high_index;
-					}
-					if (TestWall(max_corner.x, relative_position.x, relative_position.y, player_delta.x, player_delta.y, min_time, min_corner.y, max_corner.y))
-					{
-						wall_normal = V2{ 1, 0 };
-						hit_high_entity_index = test_high_index;
-					}
-					if (TestWall(min_corner.y, relative_position.y, relative_position.x, player_delta.y, player_delta.x, min_time, min_corner.x, max_corner.x))
-					{
-						wall_normal = V2{ 0, -1 };
-						hit_high_entity_index = test_high_index;
-					}
-					if (TestWall(max_corner.y, relative_position.y, relative_position.x, player_delta.y, player_delta.x, min_time, min_corner.x, max_corner.x))
-					{
-						wall_normal = V2{ 0, 1 };
-						hit_high_entity_index = test_high_index;
-					}
-				}
-			}
+		//Note: a gather can reach every high entity, so each scratch is sized for all of them, but only once per thread
+		MoverScratchPool pool{};
+		pool.count = Minimum(task_count, global_platform_work_thread_count + 1);
+		pool.in_use = PushArray(arena, pool.count, u32, ArenaTag_FrameScratch, Align(CACHE_LINE_SIZE, true));
+		pool.scratches = PushArray(arena, pool.count, CollisionScratch, ArenaTag_FrameScratch);
+		for (u32 scratch_index = 0; scratch_index < pool.count; ++scratch_index)
+		{
+			InitializeCollisionScratch(pool.scratches[scratch_index], arena, game_state.high_entities.count, ArenaTag_FrameScratch);
 		}
 
-		entity.high->position += min_time * player_delta;
-		if (hit_high_entity_index)
+		MoverTask* tasks = PushArray(arena, task_count, MoverTask, ArenaTag_FrameScratch, Align(CACHE_LINE_SIZE, true));
+		for (u32 task_index = 0; task_index < task_count; ++task_index)
 		{
-			entity.high->velocity = entity.high->velocity - Inner(entity.high->velocity, wall_normal) * wall_normal;
-			player_delta = desired_position - entity.high->position;
-			player_delta = player_delta - Inner(player_delta, wall_normal) * wall_normal;
+			MoverTask& task = tasks[task_index];
+			task.game_state = &game_state;
+			task.delta_time = delta_time;
+			task.first_mover = static_cast<u32>((static_cast<u64>(mover_count) * task_index) / task_count);
+			task.one_past_last_mover = static_cast<u32>((static_cast<u64>(mover_count) * (task_index + 1)) / task_count);
+			task.movers = movers;
+			task.steps = steps;
+			task.scratch_pool = &pool;
+		}
 
-			Entity hit_entity = GetHighEntity(game_state, hit_high_entity_index);
-			entity.high->tile_z += static_cast<u32>(static_cast<i32>(entity.high->tile_z) + hit_entity.low->velocity_tile_z);
+		if (task_count == 1)
+		{
+			DoMoverTask(queue, tasks);
 		}
 		else
 		{
-			break;
+			for (u32 task_index = 0; task_index < task_count; ++task_index)
+			{
+				global_platform_add_work_entry(queue, DoMoverTask, tasks + task_index);
+			}
+			global_platform_complete_all_work(queue);
+		}
+
+		for (u32 mover_index = 0; mover_index < mover_count; ++mover_index)
+		{
+			CommitMoverStep(game_state, movers[mover_index].high_index, steps[mover_index]);
 		}
 
+		EndTemporaryMemory(temp_memory);
+	}
+
+	END_TIMED_BLOCK(MoveEntities);
+}
+
+struct Debug_MoverBroadphaseResult
+{
+	u32 wall_count;
+	u32 mover_count;
+	u32 frame_count;
+
+	//Note: index by [grid][wide narrowphase], all on the calling thread
+	u64 cycles[2][2];
+	u64 threaded_cycles; //Note: grid and wide narrowphase, the tasks on the work queue
+
+	u32 mismatch_count; //Note: movers that end up somewhere else than with the old test-everything scalar path, expected 0
+};
+
+//Note: walls on every other tile of a square room, movers in the gaps between them, everything high frequency
+internal_static GameState* Debug_BuildMoverRoom(MemoryArena& arena, u32 wall_count, u32 mover_count)
+{
+	GameState* game_state = PushStruct(arena, GameState, ArenaTag_FrameScratch, Align(CACHE_LINE_SIZE, true));
+	game_state->world = PushStruct(arena, World, ArenaTag_World, Align(CACHE_LINE_SIZE, true));
+	World& world = *game_state->world;
+	SubArena(world.arena, arena, MegaBytes(16), ArenaTag_World);
+	InitializeTileMap(world, 1.4f);
+
+	InitializeHighEntitySet(game_state->high_entities, arena, HIGH_ENTITY_MAX_COUNT);
+	ReserveHighEntities(game_state->high_entities, 1);
+	game_state->high_entities.count = 1;
+	InitializeHighEntityGrids(*game_state, arena, HIGH_ENTITY_MAX_COUNT);
+	game_state->low_entity_count = 1;
+
+	i32 room_side = 1;
+	while (static_cast<u32>(room_side * room_side) < wall_count)
+	{
+		++room_side;
 	}
+	game_state->camera_position.tile_x = room_side;
+	game_state->camera_position.tile_y = room_side;
 
-	if (entity.high->velocity.x == 0.f && entity.high->velocity.y == 0.f)
+	for (u32 wall_index = 0; wall_index < wall_count; ++wall_index)
 	{
-		//Note: dont set facing when still
+		i32 tile_x = 2 * (static_cast<i32>(wall_index) % room_side);
+		i32 tile_y = 2 * (static_cast<i32>(wall_index) / room_side);
+		MakeEntityHighFrequency(*game_state, AddWall(*game_state, tile_x, tile_y, 0).index);
+	}
+
+	//Note: spread over the gaps with a stride coprime to their count
+	u32 gap_count = static_cast<u32>((room_side - 1) * (room_side - 1));
+	for (u32 mover_index = 0; mover_index < mover_count; ++mover_index)
+	{
+		u32 gap_index = (mover_index * 7919u) % gap_count;
+		EntityHandle handle = AddLowEntity(*game_state, EntityType_Hero);
+		LowEntity* entity = GetLowEntity(*game_state, handle);
+		entity->position.tile_x = 2 * static_cast<i32>(gap_index % static_cast<u32>(room_side - 1)) + 1;
+		entity->position.tile_y = 2 * static_cast<i32>(gap_index / static_cast<u32>(room_side - 1)) + 1;
+		entity->height = 0.5f;
+		entity->width = 1.0f;
+		entity->collides = true;
+		entity->moves = true;
+		PlaceLowEntity(*game_state, handle.index);
+		MakeEntityHighFrequency(*game_state, handle.index);
 	}
-	else if (AbsoluteValue(entity.high->velocity.x) > AbsoluteValue(entity.high->velocity.y))
+
+	return game_state;
+}
+
+//Note: moves every mover through the same frames with and without the grid and the simd narrowphase, then once more
+//split over the work queue, on a fresh copy of the room each time. Everything lives in a temporary block of the given arena
+internal_static Debug_MoverBroadphaseResult Debug_BenchmarkMoverBroadphase(MemoryArena& arena, PlatformWorkQueue* queue, u32 wall_count, u32 mover_count, u32 frame_count)
+{
+	Debug_MoverBroadphaseResult result{};
+	result.wall_count = wall_count;
+	result.mover_count = mover_count;
+	result.frame_count = frame_count;
+
+	TemporaryMemory temp_memory = BeginTemporaryMemory(arena);
+
+	V2* reference_positions = PushArray(arena, mover_count, V2, ArenaTag_FrameScratch);
+	V2 directions[] = { { 1.f, 0.3f }, { -0.2f, 1.f }, { -1.f, -0.6f }, { 0.5f, -1.f } };
+	r32 delta_time = 1.f / 30.f;
+
+	for (u32 pass = 0; pass < 5; ++pass)
 	{
-		if (entity.high->velocity.x > 0)
+		b32 use_queue = (pass == 4);
+		u32 use_grid = use_queue ? 1 : pass >> 1;
+		u32 use_wide = use_queue ? 1 : pass & 1;
+		TemporaryMemory room_memory = BeginTemporaryMemory(arena);
+
+		GameState& game_state = *Debug_BuildMoverRoom(arena, wall_count, mover_count);
+		game_state.high_entity_grid.debug_test_all = !use_grid;
+		game_state.high_entity_grid.debug_scalar_narrowphase = !use_wide;
+		u32 first_mover_index = 1 + wall_count;
+
+		u64 start_cycle_count = __rdtsc();
+		for (u32 frame_index = 0; frame_index < frame_count; ++frame_index)
 		{
-			entity.high->facing_direction = 0;
+			for (u32 mover_index = 0; mover_index < mover_count; ++mover_index)
+			{
+				HighEntitySlot mover = GetHighEntitySlot(game_state.high_entities, game_state.low_entities[first_mover_index + mover_index].high_entity_index);
+				mover.block->acceleration[mover.index] = directions[(mover_index + frame_index / 8) % ArrayCount(directions)];
+			}
+			MoveEntities(game_state, delta_time, arena, use_queue ? queue : nullptr);
 		}
-		else
+		u64 cycle_count = __rdtsc() - start_cycle_count;
+		if (use_queue)
 		{
-			entity.high->facing_direction = 2;
+			result.threaded_cycles = cycle_count;
 		}
-	}
-	else if (AbsoluteValue(entity.high->velocity.x) < AbsoluteValue(entity.high->velocity.y))
-	{
-		if (entity.high->velocity.y > 0)
+		else
 		{
-			entity.high->facing_direction = 1;
+			result.cycles[use_grid][use_wide] = cycle_count;
 		}
-		else
+
+		for (u32 mover_index = 0; mover_index < mover_count; ++mover_index)
 		{
-			entity.high->facing_direction = 3;
+			V2 position = GetHighPosition(game_state.high_entities, game_state.low_entities[first_mover_index + mover_index].high_entity_index);
+			if (pass == 0)
+			{
+				reference_positions[mover_index] = position;
+			}
+			else if (position.x != reference_positions[mover_index].x || position.y != reference_positions[mover_index].y)
+			{
+				++result.mismatch_count;
+			}
 		}
+
+		EndTemporaryMemory(room_memory);
 	}
 
-	entity.low->position = MapIntoTileSpace(world, game_state.camera_position, entity.high->position);
+	EndTemporaryMemory(temp_memory);
+
+	return result;
 }
 
 internal_static void SetCamera(GameState& game_state, WorldPosition new_camera_position)
 {
+	BEGIN_TIMED_BLOCK(SetCamera);
+
 	World& world = *(game_state.world);
+	EntityResidency& residency = game_state.residency;
 
+	b32 camera_moved = !IsSameTile(game_state.camera_position, new_camera_position);
 	WorldDifference delta_camera_position = Subtract(world, new_camera_position, game_state.camera_position);
 	game_state.camera_position = new_camera_position;
 
-	i32 tile_span_x = 17 * 3;
-	i32 tile_span_y = 9 * 3;
+	i32 tile_span_x = 17 * 3 + 2 * residency.prefetch_margin_x;
+	i32 tile_span_y = 9 * 3 + 2 * residency.prefetch_margin_y;
 	Rectangle camera_in_bounds = RectCenterDim(V2{}, V2{ static_cast<r32>(tile_span_x), static_cast<r32>(tile_span_y) } * world.tile_side_in_meters);
 	V2 entity_offset_for_frame = -delta_camera_position.delta_xy;
-	OffsetAndCheckFrequencyByArea(game_state, entity_offset_for_frame, camera_in_bounds);
+	u32 first_outside = OffsetHighEntities(game_state.high_entities, entity_offset_for_frame, camera_in_bounds);
+	if (entity_offset_for_frame.x != 0.f || entity_offset_for_frame.y != 0.f)
+	{
+		game_state.high_entity_grid.needs_rebuild = true;
+		++game_state.static_layer_version;
+	}
 
-	i32 min_tile_x = new_camera_position.tile_x - tile_span_x / 2;
-	i32 min_tile_y = new_camera_position.tile_y - tile_span_y / 2;
-	i32 max_tile_x = new_camera_position.tile_x + tile_span_x / 2;
-	i32 max_tile_y = new_camera_position.tile_y + tile_span_y / 2;
+	BEGIN_TIMED_BLOCK(EntityResidency);
 
-	for (u32 entity_index = 1; entity_index < game_state.low_entity_count; ++entity_index)
+	residency.frame_stats = {};
+	ResidencyBudget budget = BeginResidencyBudget();
+
+	if (camera_moved || (residency.needs_rescan && residency.next_candidate == residency.candidate_count))
 	{
-		LowEntity& low_entity = game_state.low_entities[entity_index];
-		
-		if (low_entity.high_entity_index == 0)
+		V2 focus{};
+		LowEntity* follow = GetLowEntity(game_state, game_state.camera_follow_entity);
+		if (follow && follow->high_entity_index)
 		{
-			if (low_entity.position.tile_z == new_camera_position.tile_z &&
-				low_entity.position.tile_x >= min_tile_x &&
-				low_entity.position.tile_x <= max_tile_x &&
-				low_entity.position.tile_y >= min_tile_y &&
-				low_entity.position.tile_y <= max_tile_y)
-			{
-				MakeEntityHighFrequency(game_state, entity_index);
-			}
+			focus = GetHighPosition(game_state.high_entities, follow->high_entity_index);
+		}
+
+		QueueResidencyCandidates(game_state,
+			new_camera_position.tile_x - tile_span_x / 2,
+			new_camera_position.tile_y - tile_span_y / 2,
+			new_camera_position.tile_x + tile_span_x / 2,
+			new_camera_position.tile_y + tile_span_y / 2,
+			focus);
+	}
+
+	//Note: promotions first, the followed entity needs its surroundings more than the far side needs demoting
+	PromoteQueuedEntities(game_state, budget);
+	DemoteEntitiesOutside(game_state, first_outside, camera_in_bounds, budget);
+
+	residency.frame_stats.pending_count = residency.candidate_count - residency.next_candidate;
+	if (global_platform_get_wall_clock)
+	{
+		residency.frame_stats.microseconds = static_cast<r32>(global_platform_get_wall_clock() - budget.start_microseconds);
+	}
+
+	END_TIMED_BLOCK(EntityResidency);
+
+	END_TIMED_BLOCK(SetCamera);
+}
+
+//Note: positions are between the last two ticks, see tick_blend. Returns what was pushed, for the dirty region
+internal_static EntityDrawRecord PushHighEntity(RenderGroup& group, GameState& game_state, u32 high_index, r32 screen_center_x, r32 screen_center_y, r32 meters_to_pixels, r32 tick_blend)
+{
+	EntityDrawRecord result{};
+
+	HighEntitySlot high = GetHighEntitySlot(game_state.high_entities, high_index);
+	LowEntity& low_entity = game_state.low_entities[high.block->low_entity_index[high.index]];
+
+	V2 draw_position = V2{ high.block->position_x[high.index], high.block->position_y[high.index] } + (1.f - tick_blend) * high.block->previous_offset[high.index];
+	r32 player_gound_point_x = screen_center_x + meters_to_pixels * draw_position.x;
+	r32 player_gound_point_y = screen_center_y - meters_to_pixels * draw_position.y;
+	r32 z = -meters_to_pixels * high.block->z[high.index];
+	V2 player_left_top{
+		player_gound_point_x - meters_to_pixels * (low_entity.width * .5f),
+		player_gound_point_y - meters_to_pixels * (low_entity.height * .5f)
+	};
+	V2 player_width_height = { low_entity.width, low_entity.height };
+	V2 player_right_bottom = player_left_top + player_width_height * meters_to_pixels;
+
+	result.low_index = high.block->low_entity_index[high.index];
+	result.anchor_x = player_gound_point_x;
+	result.anchor_y = player_gound_point_y + z;
+	result.bounds.min_x = FloorToI32(player_left_top.x);
+	result.bounds.min_y = FloorToI32(player_left_top.y);
+	result.bounds.max_x = CeilToI32(player_right_bottom.x);
+	result.bounds.max_y = CeilToI32(player_right_bottom.y);
+
+	if (low_entity.type == EntityType_Hero)
+	{
+		HeroBitmap& hero_bitmap = game_state.hero_bitmaps[high.block->facing_direction[high.index]];
+		i32 lean_step = RoundToI32(-HERO_LEAN_STEPS_PER_METER_PER_SECOND * high.block->velocity[high.index].x);
+		lean_step = Maximum(-HERO_LEAN_MAX_STEP_COUNT, Minimum(lean_step, HERO_LEAN_MAX_STEP_COUNT));
+		r32 angle = static_cast<r32>(lean_step) * HERO_LEAN_RADIANS_PER_STEP;
+		PushBitmapTransformed(group, hero_bitmap.body, result.anchor_x, result.anchor_y, hero_bitmap.align_x, hero_bitmap.align_y, 1.f, angle);
+		PushBitmapTransformed(group, hero_bitmap.head, result.anchor_x, result.anchor_y, hero_bitmap.align_x, hero_bitmap.align_y, 1.f, angle);
+		PushRectangle(group, player_left_top, player_right_bottom, 1.f, 0.f, 0.f);
+
+		result.appearance = high.block->facing_direction[high.index];
+		result.angle = angle;
+		BitmapQuad body_quad = GetBitmapQuad(hero_bitmap.body, result.anchor_x, result.anchor_y, hero_bitmap.align_x, hero_bitmap.align_y, 1.f, angle);
+		BitmapQuad head_quad = GetBitmapQuad(hero_bitmap.head, result.anchor_x, result.anchor_y, hero_bitmap.align_x, hero_bitmap.align_y, 1.f, angle);
+		result.bounds = Union(result.bounds, Union(GetBitmapQuadBounds(body_quad), GetBitmapQuadBounds(head_quad)));
+	}
+	else
+	{
+		PushRectangle(group, player_left_top, player_right_bottom, 1.f, 1.f, 1.f);
+	}
+
+	return result;
+}
+
+//Note: hands the platform this frame's live and peak bytes per tag, then starts the peaks over for the next frame
+internal_static void ReportArenaTagStats(GameMemory& memory, MemoryArena** arenas, u32 arena_count)
+{
+	for (u32 tag_index = 0; tag_index < ArenaTag_Count; ++tag_index)
+	{
+		ArenaTagStats& report = memory.arena_tag_stats[tag_index];
+		report = {};
+		for (u32 arena_index = 0; arena_index < arena_count; ++arena_index)
+		{
+			ArenaTagStats stats = GetArenaTagStats(*arenas[arena_index], static_cast<ArenaTag>(tag_index));
+			report.live += stats.live;
+			report.peak += stats.peak;
+			report.push_count += stats.push_count;
 		}
 	}
+
+	for (u32 arena_index = 0; arena_index < arena_count; ++arena_index)
+	{
+		ResetArenaPeaks(*arenas[arena_index]);
+	}
+}
+
+inline void AddDebugCheck(GameMemory& memory, const char* name, u64 reference_cycles, u64 optimized_cycles, u32 mismatch_count)
+{
+	Assert(memory.debug_check_count < ArrayCount(memory.debug_checks));
+	DebugCheckResult& check = memory.debug_checks[memory.debug_check_count++];
+	check.name = name;
+	check.reference_cycles = reference_cycles;
+	check.optimized_cycles = optimized_cycles;
+	check.mismatch_count = mismatch_count;
+}
+
+//Note: sized to finish in a few seconds
+internal_static void Debug_RunChecks(GameMemory& memory, GameState& game_state, MemoryArena& arena)
+{
+	memory.debug_check_count = 0;
+
+	//Note: on a world of its own, the soak creates and releases chunks wherever its window passes
+	TemporaryMemory soak_memory = BeginTemporaryMemory(arena);
+	World* soak_world = PushStruct(arena, World, ArenaTag_World, Align(CACHE_LINE_SIZE, true));
+	SubArena(soak_world->arena, arena, MegaBytes(4), ArenaTag_World);
+	InitializeTileMap(*soak_world, 1.4f);
+	Debug_ChunkSoakResult chunk_soak_result = Debug_SoakTileChunks(*soak_world, 64 * 1024);
+	AddDebugCheck(memory, "TileChunkSoak", 0, 0, chunk_soak_result.growth_count);
+	EndTemporaryMemory(soak_memory);
+
+	//Note: one mover, a room's worth and a crowd, all in the same 10k wall room. The reference tests every mover against
+	//every wall, so the crowd only runs two frames. Only the crowd is enough tasks to show the threaded stage
+	Debug_MoverBroadphaseResult broadphase_result_1 = Debug_BenchmarkMoverBroadphase(arena, memory.work_queue, 10000, 1, 8);
+	AddDebugCheck(memory, "MoverBroadphase1", broadphase_result_1.cycles[0][0], broadphase_result_1.cycles[1][1], broadphase_result_1.mismatch_count);
+	Debug_MoverBroadphaseResult broadphase_result_64 = Debug_BenchmarkMoverBroadphase(arena, memory.work_queue, 10000, 64, 8);
+	AddDebugCheck(memory, "MoverBroadphase64", broadphase_result_64.cycles[0][0], broadphase_result_64.cycles[1][1], broadphase_result_64.mismatch_count);
+	Debug_MoverBroadphaseResult broadphase_result_1024 = Debug_BenchmarkMoverBroadphase(arena, memory.work_queue, 10000, 1024, 2);
+	AddDebugCheck(memory, "MoverBroadphase1024", broadphase_result_1024.cycles[0][0], broadphase_result_1024.cycles[1][1], broadphase_result_1024.mismatch_count);
+	AddDebugCheck(memory, "MoverStageThreaded", broadphase_result_1024.cycles[1][1], broadphase_result_1024.threaded_cycles, broadphase_result_1024.mismatch_count);
+
+	//Note: a set that stays in l1 and one that does not
+	Debug_HighEntityLayoutResult layout_result_256 = Debug_BenchmarkHighEntityLayouts(arena, 256, 2000);
+	AddDebugCheck(memory, "HighEntityLayout256", layout_result_256.aos_cycles, layout_result_256.soa_cycles, layout_result_256.mismatch_count);
+	Debug_HighEntityLayoutResult layout_result_16k = Debug_BenchmarkHighEntityLayouts(arena, 16 * 1024, 50);
+	AddDebugCheck(memory, "HighEntityLayout16k", layout_result_16k.aos_cycles, layout_result_16k.soa_cycles, layout_result_16k.mismatch_count);
+
+	//Note: far past the first block of the high set, on a room of its own so the game's entities are left alone
+	TemporaryMemory stress_memory = BeginTemporaryMemory(arena);
+	GameState& stress_state = *Debug_BuildMoverRoom(arena, 16 * 1024, 0);
+	Debug_HighEntityStressResult stress_result = Debug_StressHighEntitySet(stress_state, 16 * 1024 - 1, 20);
+	AddDebugCheck(memory, "HighEntityStress", 0, 0, stress_result.index_error_count);
+	EndTemporaryMemory(stress_memory);
+
+	TemporaryMemory spawn_soak_memory = BeginTemporaryMemory(arena);
+	GameState& spawn_soak_state = *Debug_BuildMoverRoom(arena, 64, 0);
+	Debug_EntitySpawnSoakResult spawn_soak_result = Debug_SoakEntitySpawns(spawn_soak_state, 2000);
+	AddDebugCheck(memory, "EntitySpawnSoak", 0, 0, spawn_soak_result.stale_handle_count + spawn_soak_result.leaked_slot_count);
+	EndTemporaryMemory(spawn_soak_memory);
+
+	Debug_DrawBitmapResult draw_bitmap_result = Debug_BenchmarkDrawBitmap(arena, game_state.backdrop, game_state.hero_bitmaps[0], 960, 540, 20);
+	AddDebugCheck(memory, "DrawBitmap", draw_bitmap_result.reference_cycles, draw_bitmap_result.simd_cycles, draw_bitmap_result.mismatch_count);
+
+	//Note: not timed, it only checks that blending at load matches the straight blend
+	Debug_PremultipliedBlendResult premultiplied_blend_result = Debug_CheckPremultipliedBlend();
+	AddDebugCheck(memory, "PremultipliedBlend", 0, 0, premultiplied_blend_result.mismatch_count);
+
+	Debug_SpriteAtlasFullResult sprite_atlas_full_result = Debug_CheckSpriteAtlasFull(arena);
+	AddDebugCheck(memory, "SpriteAtlasFull", 0, 0, sprite_atlas_full_result.mismatch_count);
+
+	Debug_TexturedQuadResult textured_quad_result = Debug_BenchmarkTexturedQuad(arena, game_state.backdrop, game_state.hero_bitmaps[0], 960, 540, 5);
+	AddDebugCheck(memory, "TexturedQuad", textured_quad_result.reference_cycles, textured_quad_result.simd_cycles, textured_quad_result.mismatch_count);
+	AddDebugCheck(memory, "TexturedQuadBlit", textured_quad_result.blit_cycles, textured_quad_result.quad_blit_cycles, textured_quad_result.blit_mismatch_count);
+
+	Debug_FillRectangleResult fill_rectangle_result = Debug_BenchmarkFillRectangle(arena, 960, 540, 50);
+	AddDebugCheck(memory, "FillRectangleSmall", fill_rectangle_result.reference_small_cycles, fill_rectangle_result.simd_small_cycles, fill_rectangle_result.small_mismatch_count);
+	AddDebugCheck(memory, "FillRectangleClear", fill_rectangle_result.reference_clear_cycles, fill_rectangle_result.simd_clear_cycles, fill_rectangle_result.clear_mismatch_count);
+	AddDebugCheck(memory, "RenderGradient", fill_rectangle_result.reference_gradient_cycles, fill_rectangle_result.simd_gradient_cycles, fill_rectangle_result.gradient_mismatch_count);
+
+	Debug_TiledRenderResult tiled_render_result = Debug_BenchmarkTiledRender(arena, memory.work_queue, game_state.backdrop, game_state.hero_bitmaps[0], 1920, 1080, 5);
+	AddDebugCheck(memory, "TiledRender", tiled_render_result.single_cycles, tiled_render_result.tiled_cycles,
+		tiled_render_result.mismatch_count + tiled_render_result.missing_asset_count);
 }
 
 extern "C"
 ENGINE_API GAME_LOOP(PlatformLoop)
 {
+	debug_global_memory = memory;
+	BEGIN_TIMED_BLOCK(PlatformLoop);
+
 	i32 tiles_per_width = 17;
 	i32 tiles_per_height = 9;
 
+	global_report_arena_overflow = memory->PlatformReportArenaOverflow;
+	global_platform_commit_memory = memory->PlatformCommitMemory;
+	global_platform_get_wall_clock = memory->PlatformGetWallClockMicroseconds;
+	global_platform_add_work_entry = memory->PlatformAddWorkEntry;
+	global_platform_complete_all_work = memory->PlatformCompleteAllWork;
+	global_platform_work_thread_count = memory->work_queue_thread_count;
+	b32 commit_on_demand = (memory->PlatformCommitMemory != nullptr);
+
 	GameState* game_state = reinterpret_cast<GameState*>(memory->permanent_storage);
 	Assert(sizeof(game_state) <= memory->permanent_storage_size);
 	if (!memory->is_initialized)
 	{
+		//Note: when storage is only reserved, the state headers need pages before anything touches them
+		if (commit_on_demand)
+		{
+			b32 committed = memory->PlatformCommitMemory(memory->permanent_storage, sizeof(GameState)) &&
+				memory->PlatformCommitMemory(memory->transient_storage, sizeof(TransientState));
+			Assert(committed);
+		}
+
 		//null entity index
 		AddLowEntity(*game_state, EntityType_Null);
-		game_state->high_entity_count = 1;
 
-		game_state->backdrop = Debug_LoadBMP(thread, memory->Debug_PlatformRead, "test/test_background.bmp");
+		InitializeArena(game_state->world_arena, 
+			memory->permanent_storage_size - sizeof(GameState),
+			static_cast<u8*>(memory->permanent_storage) + sizeof(GameState),
+			commit_on_demand);
+
+		//Note: the backdrop across the top, the hero sprites packed in a row beneath it
+		InitializeSpriteAtlas(game_state->sprite_atlas, game_state->world_arena, 1024, 1024);
+
+		game_state->backdrop = Debug_LoadBMP(thread, memory->Debug_PlatformRead, memory->Debug_PlatformFree, game_state->sprite_atlas, "test/test_background.bmp");
 
 		HeroBitmap* bitmap;
 
 		bitmap = game_state->hero_bitmaps;
-		bitmap->head = Debug_LoadBMP(thread, memory->Debug_PlatformRead, "test/test_head_right.bmp");
-		bitmap->body = Debug_LoadBMP(thread, memory->Debug_PlatformRead, "test/test_body.bmp");
+		bitmap->head = Debug_LoadBMP(thread, memory->Debug_PlatformRead, memory->Debug_PlatformFree, game_state->sprite_atlas, "test/test_head_right.bmp");
+		bitmap->body = Debug_LoadBMP(thread, memory->Debug_PlatformRead, memory->Debug_PlatformFree, game_state->sprite_atlas, "test/test_body.bmp");
 		bitmap->align_x = 74;
 		bitmap->align_y = 198;
 
 		++bitmap;
-		bitmap->head = Debug_LoadBMP(thread, memory->Debug_PlatformRead, "test/test_head_back.bmp");
-		bitmap->body = Debug_LoadBMP(thread, memory->Debug_PlatformRead, "test/test_body.bmp");
+		bitmap->head = Debug_LoadBMP(thread, memory->Debug_PlatformRead, memory->Debug_PlatformFree, game_state->sprite_atlas, "test/test_head_back.bmp");
+		bitmap->body = Debug_LoadBMP(thread, memory->Debug_PlatformRead, memory->Debug_PlatformFree, game_state->sprite_atlas, "test/test_body.bmp");
 		bitmap->align_x = 74;
 		bitmap->align_y = 198;
 
 		++bitmap;
-		bitmap->head = Debug_LoadBMP(thread, memory->Debug_PlatformRead, "test/test_head_left.bmp");
-		bitmap->body = Debug_LoadBMP(thread, memory->Debug_PlatformRead, "test/test_body.bmp");
+		bitmap->head = Debug_LoadBMP(thread, memory->Debug_PlatformRead, memory->Debug_PlatformFree, game_state->sprite_atlas, "test/test_head_left.bmp");
+		bitmap->body = Debug_LoadBMP(thread, memory->Debug_PlatformRead, memory->Debug_PlatformFree, game_state->sprite_atlas, "test/test_body.bmp");
 		bitmap->align_x = 74;
 		bitmap->align_y = 198;
 
 		++bitmap;
-		bitmap->head = Debug_LoadBMP(thread, memory->Debug_PlatformRead, "test/test_head.bmp");
-		bitmap->body = Debug_LoadBMP(thread, memory->Debug_PlatformRead, "test/test_body.bmp");
+		bitmap->head = Debug_LoadBMP(thread, memory->Debug_PlatformRead, memory->Debug_PlatformFree, game_state->sprite_atlas, "test/test_head.bmp");
+		bitmap->body = Debug_LoadBMP(thread, memory->Debug_PlatformRead, memory->Debug_PlatformFree, game_state->sprite_atlas, "test/test_body.bmp");
 		bitmap->align_x = 74;
 		bitmap->align_y = 198;
 
-		InitializeArena(game_state->world_arena, 
-			memory->permanent_storage_size - sizeof(GameState),
-			static_cast<u8*>(memory->permanent_storage) + sizeof(GameState));
 
-		game_state->world = PushStruct(game_state->world_arena, World);
+		game_state->world = PushStruct(game_state->world_arena, World, ArenaTag_World, Align(CACHE_LINE_SIZE, true));
 		World& world = *game_state->world;
+		SubArena(world.arena, game_state->world_arena, MegaBytes(64), ArenaTag_World);
 
 		InitializeTileMap(world, 1.4f);
 
+		InitializeHighEntitySet(game_state->high_entities, game_state->world_arena, HIGH_ENTITY_MAX_COUNT);
+		ReserveHighEntities(game_state->high_entities, 1);
+		game_state->high_entities.count = 1; //null entity
+		InitializeHighEntityGrids(*game_state, game_state->world_arena, HIGH_ENTITY_MAX_COUNT);
+
+		//Note: prefetch one room past the camera span, so a flip-screen jump finds most of its entities already high
+		EntityResidency& residency = game_state->residency;
+		InitializeEntityResidency(residency, game_state->world_arena, HIGH_ENTITY_MAX_COUNT);
+		residency.budget_count = 1024;
+		residency.required_radius = static_cast<r32>(tiles_per_width) * world.tile_side_in_meters;
+		residency.prefetch_margin_x = tiles_per_width;
+		residency.prefetch_margin_y = tiles_per_height;
+
+
 		i32 screen_base_x = 0;
 		i32 screen_base_y = 0;
 		i32 screen_base_z = 0;
@@ -857,6 +4265,8 @@ ENGINE_API GAME_LOOP(PlatformLoop)
 		}
 #endif
 
+		MergeStaticWalls(*game_state);
+
 		WorldPosition new_camera_position{};
 		new_camera_position.tile_x = screen_base_x + tiles_per_width / 2;
 		new_camera_position.tile_y = screen_base_y + tiles_per_height / 2;
@@ -866,6 +4276,35 @@ ENGINE_API GAME_LOOP(PlatformLoop)
 		memory->is_initialized = true;
 	}
 
+	Assert(sizeof(TransientState) <= memory->transient_storage_size);
+	TransientState* tran_state = reinterpret_cast<TransientState*>(memory->transient_storage);
+	if (!tran_state->is_initialized)
+	{
+		InitializeArena(tran_state->transient_arena,
+			memory->transient_storage_size - sizeof(TransientState),
+			static_cast<u8*>(memory->transient_storage) + sizeof(TransientState),
+			commit_on_demand);
+
+		//Note: sized to the buffer it starts with, a buffer that changes size afterwards is drawn without the cache
+		GameOffscreenBuffer& static_layer = tran_state->static_layer.layer;
+		static_layer.width = buffer.width;
+		static_layer.height = buffer.height;
+		static_layer.bytes_per_pixel = 4;
+		static_layer.pitch = static_cast<i32>(AlignPow2(static_cast<u32>(buffer.width) * 4, CACHE_LINE_SIZE));
+		static_layer.memory = PushSize(tran_state->transient_arena, static_cast<MemoryIndex>(static_layer.pitch) * static_cast<MemoryIndex>(buffer.height),
+			ArenaTag_RenderCache, AlignNoClear(CACHE_LINE_SIZE));
+		tran_state->static_layer.version = 0;
+
+		tran_state->is_initialized = true;
+
+		if (memory->debug_run_checks)
+		{
+			Debug_RunChecks(*memory, *game_state, tran_state->transient_arena);
+		}
+	}
+
+	TemporaryMemory frame_memory = BeginTemporaryMemory(tran_state->transient_arena);
+
 	World& world = *(game_state->world);
 
 	i32 tile_side_in_pixels = 60;
@@ -875,110 +4314,165 @@ ENGINE_API GAME_LOOP(PlatformLoop)
 	r32 lower_left_x = -r_tile_side_in_pixels/2;
 	r32 lower_left_y = static_cast<r32>(buffer.height);
 
-	for (u64 controller_index = 0; controller_index < ArrayCount(input->controllers); ++controller_index)
+	//Note: the input is held for every tick of the frame. The tolerance keeps a frame that is a whole number of ticks
+	//from losing one to rounding
+	game_state->tick_accumulator = Minimum(game_state->tick_accumulator + input->frame_delta,
+		static_cast<r32>(SIMULATION_MAX_TICKS_PER_FRAME) * SIMULATION_SECONDS_PER_TICK);
+	while (game_state->tick_accumulator > 0.999f * SIMULATION_SECONDS_PER_TICK)
 	{
-		const GameControllerInput& controller = input->controllers[controller_index];
+		game_state->tick_accumulator = Maximum(game_state->tick_accumulator - SIMULATION_SECONDS_PER_TICK, 0.f);
+		++game_state->tick_index;
+
+		for (u64 controller_index = 0; controller_index < ArrayCount(input->controllers); ++controller_index)
 		{
-			u32 low_index = game_state->player_index_for_controller[controller_index];
-			if (low_index == 0)
-			{
-				if (controller.start.is_ended_down)
-				{
-					u32 entity_index = AddPlayer(*game_state);
-					game_state->player_index_for_controller[controller_index] = entity_index;
-				}
-			}
-			else
+			const GameControllerInput& controller = input->controllers[controller_index];
 			{
-				Entity controlling_entity = GetHighEntity(*game_state, low_index);
-
-				V2 player_acceleration{};
-
-				if (controller.is_analog)
+				EntityHandle player = game_state->player_for_controller[controller_index];
+				if (!IsEntityHandleValid(*game_state, player))
 				{
-					player_acceleration = { controller.stick_average_x, controller.stick_average_y };
+					if (controller.start.is_ended_down)
+					{
+						game_state->player_for_controller[controller_index] = AddPlayer(*game_state);
+					}
 				}
 				else
 				{
+					Entity controlling_entity = GetHighEntity(*game_state, player);
 
-					if (controller.move_up.is_ended_down)
-					{
-						player_acceleration.y = 1.f;
-					}
-					if (controller.move_down.is_ended_down)
+					V2 player_acceleration{};
+
+					if (controller.is_analog)
 					{
-						player_acceleration.y = -1.f;
+						player_acceleration = { controller.stick_average_x, controller.stick_average_y };
 					}
-					if (controller.move_left.is_ended_down)
+					else
 					{
-						player_acceleration.x = -1.f;
+
+						if (controller.move_up.is_ended_down)
+						{
+							player_acceleration.y = 1.f;
+						}
+						if (controller.move_down.is_ended_down)
+						{
+							player_acceleration.y = -1.f;
+						}
+						if (controller.move_left.is_ended_down)
+						{
+							player_acceleration.x = -1.f;
+						}
+						if (controller.move_right.is_ended_down)
+						{
+							player_acceleration.x = 1.f;
+						}
 					}
-					if (controller.move_right.is_ended_down)
+					HighEntitySlot controlling_high = GetHighEntitySlot(game_state->high_entities, controlling_entity.high_index);
+					if (controller.action_up.is_ended_down)
 					{
-						player_acceleration.x = 1.f;
+						controlling_high.block->delta_z[controlling_high.index] = 3.f;
 					}
-				}
-				if (controller.action_up.is_ended_down)
-				{
-					controlling_entity.high->delta_z = 3.f;
-				}
 
-				MovePlayer(*game_state, controlling_entity, input->frame_delta, player_acceleration);
+					controlling_high.block->acceleration[controlling_high.index] = player_acceleration;
+				}
 			}
 		}
-	}
 
-	Entity camera_following_entity = GetHighEntity(*game_state, game_state->camera_follow_entity_index);
-	if (camera_following_entity.high)
-	{
-		WorldPosition new_camera_position = game_state->camera_position;
+		MoveEntities(*game_state, SIMULATION_SECONDS_PER_TICK, tran_state->transient_arena, memory->work_queue);
 
-		new_camera_position.tile_z = camera_following_entity.low->position.tile_z;
+		r32 gravity = -9.8f;
+		IntegrateHighEntityZ(game_state->high_entities, SIMULATION_SECONDS_PER_TICK, gravity);
 
-#if 1 //no scrolling cam
-		if (camera_following_entity.high->position.x > 9.f * world.tile_side_in_meters)
+		Entity camera_following_entity = GetHighEntity(*game_state, game_state->camera_follow_entity);
+		if (camera_following_entity.high_index)
 		{
-			new_camera_position.tile_x += tiles_per_width;
-		}
-		else if (camera_following_entity.high->position.x < -9.f * world.tile_side_in_meters)
-		{
-			new_camera_position.tile_x -= tiles_per_width;
-		}
-		if (camera_following_entity.high->position.y > 5.f * world.tile_side_in_meters)
-		{
-			new_camera_position.tile_y += tiles_per_height;
-		}
-		else if (camera_following_entity.high->position.y < -5.f * world.tile_side_in_meters)
-		{
-			new_camera_position.tile_y -= tiles_per_height;
-		}
+			V2 camera_following_position = GetHighPosition(game_state->high_entities, camera_following_entity.high_index);
+			WorldPosition new_camera_position = game_state->camera_position;
+
+			new_camera_position.tile_z = camera_following_entity.low->position.tile_z;
+
+#if 1 //no scrolling cam
+			if (camera_following_position.x > 9.f * world.tile_side_in_meters)
+			{
+				new_camera_position.tile_x += tiles_per_width;
+			}
+			else if (camera_following_position.x < -9.f * world.tile_side_in_meters)
+			{
+				new_camera_position.tile_x -= tiles_per_width;
+			}
+			if (camera_following_position.y > 5.f * world.tile_side_in_meters)
+			{
+				new_camera_position.tile_y += tiles_per_height;
+			}
+			else if (camera_following_position.y < -5.f * world.tile_side_in_meters)
+			{
+				new_camera_position.tile_y -= tiles_per_height;
+			}
 #else	//scrolling cam
-		if (camera_following_entity.high->position.x > 1.f * world.tile_side_in_meters)
-		{
-			new_camera_position.tile_x += 1;
-		}
-		else if (camera_following_entity.high->position.x < -1.f * world.tile_side_in_meters)
-		{
-			new_camera_position.tile_x -= 1;
-		}
-		if (camera_following_entity.high->position.y > 1.f * world.tile_side_in_meters)
-		{
-			new_camera_position.tile_y += 1;
-		}
-		else if (camera_following_entity.high->position.y < -1.f * world.tile_side_in_meters)
-		{
-			new_camera_position.tile_y -= 1;
-		}
+			if (camera_following_position.x > 1.f * world.tile_side_in_meters)
+			{
+				new_camera_position.tile_x += 1;
+			}
+			else if (camera_following_position.x < -1.f * world.tile_side_in_meters)
+			{
+				new_camera_position.tile_x -= 1;
+			}
+			if (camera_following_position.y > 1.f * world.tile_side_in_meters)
+			{
+				new_camera_position.tile_y += 1;
+			}
+			else if (camera_following_position.y < -1.f * world.tile_side_in_meters)
+			{
+				new_camera_position.tile_y -= 1;
+			}
 #endif
 
-		SetCamera(*game_state, new_camera_position);
+			SetCamera(*game_state, new_camera_position);
+		}
 	}
 
-	DrawBitmap(buffer, game_state->backdrop, 0.f, 0.f);
+	//Note: entities are drawn between the last two ticks, as far along as the time left over is of a tick
+	r32 tick_blend = game_state->tick_accumulator / SIMULATION_SECONDS_PER_TICK;
 
 	r32 screen_center_x = .5f * static_cast<r32>(buffer.width);
 	r32 screen_center_y = .5f * static_cast<r32>(buffer.height);
 
+	HighEntitySet& high_entities = game_state->high_entities;
+
+	//Note: the static layer is only redrawn in the frame something in it changed, the camera shifting or a wall entering
+	//or leaving the high set. Walls are never interpolated, so it holds whatever tick_blend is
+	StaticLayerCache& static_layer = tran_state->static_layer;
+	b32 use_static_layer = (static_layer.layer.width == buffer.width && static_layer.layer.height == buffer.height);
+	b32 static_layer_rebuilt = false;
+	if (use_static_layer && static_layer.version != game_state->static_layer_version)
+	{
+		RenderGroup* static_group = AllocateRenderGroup(tran_state->transient_arena, MegaBytes(16));
+		PushClear(*static_group, 0.f, 0.f, 0.f);
+		PushBitmap(*static_group, game_state->backdrop, 0.f, 0.f);
+		for (u32 high_index = 0; high_index < high_entities.count; ++high_index)
+		{
+			if (!game_state->low_entities[GetHighLowIndex(high_entities, high_index)].moves)
+			{
+				PushHighEntity(*static_group, *game_state, high_index, screen_center_x, screen_center_y, meters_to_pixels, tick_blend);
+			}
+		}
+
+		TiledRenderGroupToOutput(memory->work_queue, *static_group, static_layer.layer, tran_state->transient_arena);
+		static_layer.version = game_state->static_layer_version;
+		static_layer_rebuilt = true;
+	}
+
+	//Note: sized for a rectangle and two bitmaps for every high entity
+	RenderGroup* render_group = AllocateRenderGroup(tran_state->transient_arena, MegaBytes(16));
+
+	if (use_static_layer)
+	{
+		PushLayer(*render_group, static_layer.layer);
+	}
+	else
+	{
+		PushClear(*render_group, 0.f, 0.f, 0.f);
+		PushBitmap(*render_group, game_state->backdrop, 0.f, 0.f);
+	}
+
 #if 0
 	for (i32 relative_row = -10; relative_row < 10; ++relative_row)
 	{
@@ -1013,50 +4507,91 @@ ENGINE_API GAME_LOOP(PlatformLoop)
 				V2 min = center - v2_tile_side_in_pixels;
 				V2 max = center + v2_tile_side_in_pixels;
 
-				DrawRectangle(buffer, min, max, shade, shade, shade);
+				PushRectangle(*render_group, min, max, shade, shade, shade);
 			}
 		}
 	}
 #endif
 
-	for (u32 high_index = 0; high_index < game_state->high_entity_count; ++high_index)
+	EntityDrawRecord* draw_records = PushArray(tran_state->transient_arena, high_entities.count, EntityDrawRecord, ArenaTag_FrameScratch, AlignNoClear(CACHE_LINE_SIZE));
+	u32 draw_record_count = 0;
+	for (u32 high_index = 0; high_index < high_entities.count; ++high_index)
 	{
-			HighEntity& high_entity = game_state->high_entities[high_index];
-			LowEntity& low_entity = game_state->low_entities[high_entity.low_entity_index];
-
-			//high_entity.position += entity_offset_for_frame;
+		if (!use_static_layer || game_state->low_entities[GetHighLowIndex(high_entities, high_index)].moves)
+		{
+			draw_records[draw_record_count++] = PushHighEntity(*render_group, *game_state, high_index, screen_center_x, screen_center_y, meters_to_pixels, tick_blend);
+		}
+	}
 
-			r32 dt = input->frame_delta;
-			r32 gravity = -9.8f;
-			high_entity.z += 0.5f * gravity * Square(dt) + high_entity.delta_z * dt;
-			high_entity.delta_z += gravity * dt;
-			if (high_entity.z < 0)
+	//Note: with the static layer unchanged only the movers can have changed pixels. Each one that is not drawn exactly as
+	//last frame's mover in its place dirties both where it was and where it is now
+	GameDirtyRegion& dirty_region = memory->dirty_region;
+	dirty_region = {};
+	Rectangle2i buffer_rect = GetBufferRect(buffer);
+	DirtyRegionTracker& dirty_tracker = tran_state->dirty_tracker;
+	b32 full_redraw = memory->debug_force_full_redraw || !use_static_layer || static_layer_rebuilt || !dirty_tracker.is_valid || draw_record_count > DIRTY_RECORD_MAX_COUNT;
+	if (!full_redraw)
+	{
+		u32 record_count = Maximum(draw_record_count, dirty_tracker.record_count);
+		for (u32 record_index = 0; record_index < record_count; ++record_index)
+		{
+			b32 has_previous = record_index < dirty_tracker.record_count;
+			b32 has_current = record_index < draw_record_count;
+			if (!has_previous || !has_current || !IsSameDrawRecord(dirty_tracker.records[record_index], draw_records[record_index]))
 			{
-				high_entity.z = 0;
+				if (has_previous)
+				{
+					AddDirtyRect(dirty_region, buffer_rect, dirty_tracker.records[record_index].bounds);
+				}
+				if (has_current)
+				{
+					AddDirtyRect(dirty_region, buffer_rect, draw_records[record_index].bounds);
+				}
 			}
+		}
 
-			r32 player_gound_point_x = screen_center_x + meters_to_pixels * high_entity.position.x;
-			r32 player_gound_point_y = screen_center_y - meters_to_pixels * high_entity.position.y;
-			r32 z = -meters_to_pixels * high_entity.z;
-			V2 player_left_top{
-				player_gound_point_x - meters_to_pixels * (low_entity.width * .5f),
-				player_gound_point_y - meters_to_pixels * (low_entity.height * .5f)
-			};
-			V2 player_width_height = { low_entity.width, low_entity.height };
+		for (u32 rect_index = 0; rect_index < dirty_region.rect_count; ++rect_index)
+		{
+			dirty_region.redrawn_pixel_count += static_cast<u64>(GetArea(dirty_region.rects[rect_index]));
+		}
 
-			if (low_entity.type == EntityType_Hero)
-			{
-				HeroBitmap& hero_bitmap = game_state->hero_bitmaps[high_entity.facing_direction];
-				DrawBitmap(buffer, hero_bitmap.body, player_gound_point_x, player_gound_point_y + z, hero_bitmap.align_x, hero_bitmap.align_y);
-				DrawBitmap(buffer, hero_bitmap.head, player_gound_point_x, player_gound_point_y + z, hero_bitmap.align_x, hero_bitmap.align_y);
-				DrawRectangle(buffer, player_left_top, player_left_top + player_width_height * meters_to_pixels, 1.f, 0.f, 0.f);
-			}
-			else
-			{
-				DrawRectangle(buffer, player_left_top, player_left_top + player_width_height * meters_to_pixels, 1.f, 1.f, 1.f);
-			}
+		u64 buffer_pixel_count = static_cast<u64>(GetArea(buffer_rect));
+		full_redraw = static_cast<r32>(dirty_region.redrawn_pixel_count) > DIRTY_REGION_FULL_REDRAW_FRACTION * static_cast<r32>(buffer_pixel_count);
+	}
+
+	if (full_redraw)
+	{
+		dirty_region = {};
+		dirty_region.is_full = true;
+		dirty_region.redrawn_pixel_count = static_cast<u64>(GetArea(buffer_rect));
+		TiledRenderGroupToOutput(memory->work_queue, *render_group, buffer, tran_state->transient_arena);
+	}
+	else if (dirty_region.rect_count)
+	{
+		TiledRenderGroupToOutput(memory->work_queue, *render_group, buffer, tran_state->transient_arena, dirty_region.rects, dirty_region.rect_count);
+	}
+
+	dirty_tracker.is_valid = use_static_layer && draw_record_count <= DIRTY_RECORD_MAX_COUNT;
+	dirty_tracker.record_count = 0;
+	if (dirty_tracker.is_valid)
+	{
+		for (u32 record_index = 0; record_index < draw_record_count; ++record_index)
+		{
+			dirty_tracker.records[record_index] = draw_records[record_index];
+		}
+		dirty_tracker.record_count = draw_record_count;
 	}
 
+	EndTemporaryMemory(frame_memory);
+
+	CheckArena(game_state->world_arena);
+	CheckArena(tran_state->transient_arena);
+
+	MemoryArena* arenas[] = { &game_state->world_arena, &world.arena, &tran_state->transient_arena };
+	ReportArenaTagStats(*memory, arenas, ArrayCount(arenas));
+
+	END_TIMED_BLOCK(PlatformLoop);
+
 	//App::Run();
 }
 
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Definition.hpp"
+#include "Memory.hpp"
+#include "SpriteAtlas.hpp"
 #include "World.hpp"
 
 #define Minimum(a, b) ((a < b)? (a) : (b))
@@ -82,43 +84,102 @@
 		return input.controllers[controller_index];
 	}
 
-	struct MemoryArena
+	struct HeroBitmap
 	{
-		MemoryIndex size;
-		u8* base;
-		MemoryIndex used;
+		i32 align_x;
+		i32 align_y;
+		LoadedBitmap head;
+		LoadedBitmap body;
 	};
 
-	internal_static void InitializeArena(MemoryArena& arena, MemoryIndex size, u8* base)
-	{
-		arena.size = size;
-		arena.base = base;
-		arena.used = 0;
-	}
+	//Note: the hero leans into its sideways speed, in whole steps so a hero sliding to a stop stands upright again instead
+	//of redrawing every frame for ever smaller drag
+	constexpr r32 HERO_LEAN_RADIANS_PER_STEP = .025f;
+	constexpr r32 HERO_LEAN_STEPS_PER_METER_PER_SECOND = 1.f;
+	constexpr i32 HERO_LEAN_MAX_STEP_COUNT = 6;
 
-	internal_static void* PushSize_(MemoryArena& arena, MemoryIndex size)
+	//Note: draw calls recorded into transient memory and played back tile by tile, in push order
+	enum RenderEntryType
 	{
-		Assert(arena.used + size <= arena.size);
-		void* result = arena.base + arena.used;
-		arena.used += size;
-		return result;
-	}
-#define PushStruct(Arena, Type) static_cast<Type*>(PushSize_(Arena, sizeof(Type)))
-#define PushArray(Arena, Count, Type) static_cast<Type*>(PushSize_(Arena, Count*sizeof(Type)))
+		RenderEntryType_Bitmap,
+		RenderEntryType_Rectangle,
+		RenderEntryType_Layer,
+		RenderEntryType_Clear,
+		RenderEntryType_TexturedQuad,
+	};
 
-	struct LoadedBitmap
+	struct RenderEntryHeader
 	{
-		i32 width;
-		i32 height;
-		u32* pixels;
+		RenderEntryType type;
 	};
 
-	struct HeroBitmap
+	struct RenderEntryBitmap
 	{
+		RenderEntryHeader header;
+		const LoadedBitmap* bitmap;
+		r32 x;
+		r32 y;
 		i32 align_x;
 		i32 align_y;
-		LoadedBitmap head;
-		LoadedBitmap body;
+		r32 c_alpha;
+	};
+
+	struct RenderEntryRectangle
+	{
+		RenderEntryHeader header;
+		V2 min;
+		V2 max;
+		u32 colour; //Note: packed when pushed, xx RR GG BB
+	};
+
+	//Note: the bitmap stretched over origin + u * x_axis + v * y_axis, u and v in [0, 1), in buffer pixels. v runs up
+	//from the bitmap's bottom row, so an upright sprite has a y_axis pointing up the screen
+	struct RenderEntryTexturedQuad
+	{
+		RenderEntryHeader header;
+		const LoadedBitmap* bitmap;
+		V2 origin;
+		V2 x_axis;
+		V2 y_axis;
+		r32 c_alpha;
+	};
+
+	struct RenderEntryClear
+	{
+		RenderEntryHeader header;
+		u32 colour;
+	};
+
+	//Note: a buffer the size of the output copied over it as is, opaque, no blending
+	struct RenderEntryLayer
+	{
+		RenderEntryHeader header;
+		const GameOffscreenBuffer* layer;
+	};
+
+	struct RenderGroup
+	{
+		u8* push_buffer_base;
+		MemoryIndex push_buffer_size;
+		MemoryIndex max_push_buffer_size;
+	};
+
+	//Note: 128kb of pixels, a tile stays in l2 while every entry is drawn into it. Tiles grow taller when a buffer
+	//would need more than RENDER_TILE_MAX_COUNT of them
+	constexpr i32 RENDER_TILE_WIDTH = 256;
+	constexpr i32 RENDER_TILE_HEIGHT = 128;
+	constexpr u32 RENDER_TILE_MAX_COUNT = 128;
+
+	//Note: fills at least this big bypass the cache instead of evicting everything else for pixels nothing reads back
+	//soon. Well above a tile, which stays cached for the entries drawn over it, and above a 960x540 buffer, which still
+	//fits in a last level cache
+	constexpr MemoryIndex FILL_STREAMING_MIN_SIZE = MegaBytes(4);
+
+	struct RenderTileWork
+	{
+		const RenderGroup* group;
+		const GameOffscreenBuffer* buffer;
+		Rectangle2i clip;
 	};
 
 	enum EntityType
@@ -126,19 +187,169 @@
 		EntityType_Null,
 		EntityType_Hero,
 		EntityType_Wall,
+		EntityType_WallRect, //Note: a run of merged wall tiles, collides and draws in their place
 	};
 
-	struct HighEntity
+	constexpr u32 HIGH_ENTITY_LANE_WIDTH = 8; //Note: widest simd lane used on the columns, avx
+	constexpr u32 HIGH_ENTITY_BLOCK_SHIFT = 8;
+	constexpr u32 HIGH_ENTITY_BLOCK_SIZE = 1 << HIGH_ENTITY_BLOCK_SHIFT;
+	constexpr u32 HIGH_ENTITY_BLOCK_MASK = HIGH_ENTITY_BLOCK_SIZE - 1;
+	constexpr u32 HIGH_ENTITY_MAX_COUNT = 64 * 1024;
+
+	static_assert(HIGH_ENTITY_BLOCK_SIZE % HIGH_ENTITY_LANE_WIDTH == 0);
+
+	//Note: columns for HIGH_ENTITY_BLOCK_SIZE entities, so the per-frame passes stream only the fields they touch.
+	//Slots past the set count are scratch the simd loops are free to run over
+	struct HighEntityBlock
+	{
+		//Note: hot, walked every frame by the z integration and the camera offset
+		r32 position_x[HIGH_ENTITY_BLOCK_SIZE];
+		r32 position_y[HIGH_ENTITY_BLOCK_SIZE];
+		r32 z[HIGH_ENTITY_BLOCK_SIZE];
+		r32 delta_z[HIGH_ENTITY_BLOCK_SIZE];
+
+		//Note: cold, only touched per entity
+		V2 velocity[HIGH_ENTITY_BLOCK_SIZE];
+		V2 acceleration[HIGH_ENTITY_BLOCK_SIZE]; //Note: input for one tick, cleared once the entity has moved
+		V2 previous_offset[HIGH_ENTITY_BLOCK_SIZE]; //Note: position at the start of the last tick minus the current one, for drawing between ticks
+		i32 tile_z[HIGH_ENTITY_BLOCK_SIZE];
+		u32 facing_direction[HIGH_ENTITY_BLOCK_SIZE];
+		u32 low_entity_index[HIGH_ENTITY_BLOCK_SIZE];
+	};
+
+	//Note: grows a block at a time out of its arena up to max_count. Blocks never move once pushed,
+	//so an index or a reference into a block stays valid while the set grows
+	struct HighEntitySet
+	{
+		u32 count;
+		u32 capacity; //Note: slots backed by blocks
+		u32 max_count;
+
+		MemoryArena* arena;
+		u32 block_count;
+		HighEntityBlock** blocks;
+	};
+
+	struct HighEntitySlot
+	{
+		HighEntityBlock* block;
+		u32 index;
+	};
+
+	//Note: what the narrowphase needs of each collider a mover can hit, padded to whole simd lanes.
+	//The corners are of the collider grown by the mover, relative to the collider's center
+	struct CollisionCandidates
+	{
+		u32 count;
+		u32* high_index;
+		r32* position_x;
+		r32* position_y;
+		r32* min_corner_x;
+		r32* min_corner_y;
+		r32* max_corner_x;
+		r32* max_corner_y;
+	};
+
+	//Note: per thread, what one move gathers and tests against
+	struct CollisionScratch
+	{
+		u32 candidate_count;
+		u32* candidates; //Note: sorted by high index, the order the narrowphase breaks ties in
+		CollisionCandidates collision_candidates;
+	};
+
+	struct MoverCollision
+	{
+		r32 min_time;
+		V2 wall_normal;
+		u32 hit_high_index; //Note: 0 when nothing was hit
+	};
+
+	constexpr u32 HIGH_ENTITY_GRID_BUCKET_COUNT = 4096;
+	constexpr u32 HIGH_ENTITY_GRID_NO_BUCKET = HIGH_ENTITY_GRID_BUCKET_COUNT;
+
+	static_assert((HIGH_ENTITY_GRID_BUCKET_COUNT & (HIGH_ENTITY_GRID_BUCKET_COUNT - 1)) == 0);
+
+	//Note: colliders wider or taller than this many cells go in the coarse grid, so one long wall does not widen every gather
+	constexpr r32 LARGE_COLLIDER_CELL_COUNT = 2.f;
+
+	//Note: broadphase for the movers, colliding high entities hashed by the cell their center is in.
+	//The hash has no bounds, entities outside the camera span are found the same way.
+	//Rebuilt only when every position shifts with the camera. Promotions and demotions link and unlink their entity,
+	//movers update their own cell as they move
+	struct HighEntityGrid
+	{
+		b32 needs_rebuild;
+		b32 debug_test_all; //Note: candidates are every high entity, for checking and timing against the grid
+		b32 debug_scalar_narrowphase; //Note: runs TestWall per wall instead of the simd walls, for checking
+
+		r32 cell_side;
+		r32 one_over_cell_side;
+		r32 max_collider_extent; //Note: largest width or height in the grid, how far a center can be from what it blocks
+
+		u32 max_count;
+		u32* bucket_first; //Note: 0 when empty, the null entity is never in the grid
+
+		//Note: per high index
+		u32* bucket; //Note: HIGH_ENTITY_GRID_NO_BUCKET when not in the grid
+		u32* next;
+		u32* prev;
+		i32* cell_x;
+		i32* cell_y;
+
+		u32 mover_count;
+		u32* movers; //Note: high indices of the entities that move, in no particular order
+		u32* mover_slot; //Note: per high index, where a mover sits in movers
+	};
+
+	constexpr u32 MOVER_TASK_MAX_COUNT = 64;
+	constexpr u32 MOVER_TASK_MIN_MOVER_COUNT = 64; //Note: below this a task costs more to hand out than to run
+	constexpr u32 MOVER_TASK_CELL_SHIFT = 3; //Note: movers are ordered by blocks of 8x8 grid cells before being split
+
+	struct MoverOrder
+	{
+		u32 sort_key; //Note: the coarse cell, y then x
+		u32 high_index;
+	};
+
+	//Note: a move worked out against the positions at the start of the stage, written back once every mover is done
+	struct MoverStep
 	{
 		V2 position;
 		V2 velocity;
 		i32 tile_z;
 		u32 facing_direction;
+	};
+
+	//Note: no more tasks run at once than there are threads working the queue, so one scratch per thread covers them.
+	//A task claims a free scratch for as long as it runs
+	struct MoverScratchPool
+	{
+		u32 count;
+		u32 volatile* in_use;
+		CollisionScratch* scratches;
+	};
+
+	struct GameState;
+
+	struct MoverTask
+	{
+		GameState* game_state;
+		r32 delta_time;
 
-		r32 z;
-		r32 delta_z;
+		u32 first_mover;
+		u32 one_past_last_mover;
+		MoverOrder* movers;
+		MoverStep* steps; //Note: indexed like movers
 
-		u32 low_entity_index;
+		MoverScratchPool* scratch_pool;
+	};
+
+	//Note: what gets stored across frames instead of a raw low index. {0, 0} never refers to anything
+	struct EntityHandle
+	{
+		u32 index;
+		u32 generation;
 	};
 
 	struct LowEntity
@@ -150,15 +361,60 @@
 
 		i32 velocity_tile_z;
 		b32 collides;
+		b32 moves; //Note: moved by the mover stage every tick it is high frequency
+		EntityHandle merged_wall; //Note: the wall rect standing in for this tile, which then neither collides nor gets promoted
 
 		u32 high_entity_index;
+
+		u32 generation; //Note: bumped when the slot is freed, so handles to the old entity go stale
+		u32 next_free_index; //Note: only meaningful while the slot sits on the free list
 	};
 
 	struct Entity
 	{
 		u32 low_index;
 		LowEntity* low;
-		HighEntity* high;
+		u32 high_index; //Note: 0 when the entity is not high frequency
+	};
+
+	struct ResidencyCandidate
+	{
+		u32 low_index;
+		r32 distance_squared; //Note: to the followed entity, the sort key
+	};
+
+	struct EntityResidencyStats
+	{
+		u32 promoted_count;
+		u32 demoted_count;
+		u32 queued_count; //Note: candidates found by a rescan this frame
+		u32 pending_count; //Note: candidates left for the next frames
+		r32 microseconds;
+	};
+
+	//Note: promotion and demotion run against a per-frame budget. A rescan queues every low entity in the camera span
+	//plus the prefetch margin, nearest to the followed entity first, and the queue is drained over as many frames as it takes.
+	//Candidates within required_radius are always promoted in the frame they are found
+	struct EntityResidency
+	{
+		u32 budget_count; //Note: per frame and per direction. A count, not a time, so replays stay deterministic
+		r32 required_radius;
+		i32 prefetch_margin_x; //Note: in tiles, on each side
+		i32 prefetch_margin_y;
+
+		b32 needs_rescan;
+		i32 scan_min_tile_x; //Note: the tile span of the last rescan, empty until the first one
+		i32 scan_min_tile_y;
+		i32 scan_max_tile_x;
+		i32 scan_max_tile_y;
+		i32 scan_tile_z;
+		u32 candidate_capacity;
+		u32 candidate_count;
+		u32 next_candidate;
+		ResidencyCandidate* candidates;
+		ResidencyCandidate* sort_temp;
+
+		EntityResidencyStats frame_stats;
 	};
 
 	struct LowEntityChunkReference
@@ -167,27 +423,79 @@
 		u32 entity_index_in_chunk;
 	};
 
+	//Note: the simulation only ever steps by this, whatever rate the platform renders at. Frames that fall further behind
+	//than the cap drop the rest of their time instead of spiralling
+	constexpr r32 SIMULATION_SECONDS_PER_TICK = 1.f / 120.f;
+	constexpr u32 SIMULATION_MAX_TICKS_PER_FRAME = 8;
+
 	struct GameState
 	{
 		MemoryArena world_arena;
 		World* world;
 
-		u32 camera_follow_entity_index;
+		EntityHandle camera_follow_entity;
 		WorldPosition camera_position;
 
-		u32 player_index_for_controller[ArrayCount(GameInput{}.controllers)];
+		EntityHandle player_for_controller[ArrayCount(GameInput{}.controllers)];
 		
-		u32 low_entity_count;
+		u32 low_entity_count; //Note: slots handed out so far, free ones included
+		u32 first_free_low_entity; //Note: 0 when the free list is empty, slot 0 is the null entity
+		u32 free_low_entity_count;
 		LowEntity low_entities[100000];
 
-		u32 high_entity_count;
-		HighEntity high_entities[256];
+		HighEntitySet high_entities;
+		HighEntityGrid high_entity_grid;
+		HighEntityGrid large_collider_grid; //Note: cells a chunk wide, see LARGE_COLLIDER_CELL_COUNT
+		EntityResidency residency;
+
+		r32 tick_accumulator; //Note: frame time not simulated yet, less than a tick between frames
+		u64 tick_index;
+
+		u32 static_layer_version; //Note: bumped when the camera shifts or an entity that does not move enters or leaves the high set
 
+		SpriteAtlas sprite_atlas; //Note: every bitmap below is a view into it
 		LoadedBitmap backdrop;
 		HeroBitmap hero_bitmaps[4];
 		u32 facing_direction;
 	};
 
+	//Note: the backdrop with every high entity that does not move drawn over it. Rebuilt when its version falls behind
+	//GameState::static_layer_version, otherwise each frame starts by copying it
+	struct StaticLayerCache
+	{
+		GameOffscreenBuffer layer;
+		u32 version; //Note: 0 until the first build
+	};
+
+	//Note: where and how a mover was drawn. A mover whose record matches last frame's record in the same place in the list
+	//left its pixels as they were, anything else dirties where it was and where it is
+	struct EntityDrawRecord
+	{
+		u32 low_index;
+		u32 appearance;
+		r32 anchor_x;
+		r32 anchor_y;
+		r32 angle;
+		Rectangle2i bounds; //Note: every pixel the entity can touch, not clipped to the buffer
+	};
+
+	constexpr u32 DIRTY_RECORD_MAX_COUNT = 1024; //Note: frames with more movers are redrawn in full
+
+	struct DirtyRegionTracker
+	{
+		b32 is_valid; //Note: false until a frame was drawn with the static layer, and after one that overflowed
+		u32 record_count;
+		EntityDrawRecord records[DIRTY_RECORD_MAX_COUNT];
+	};
+
+	struct TransientState
+	{
+		b32 is_initialized;
+		MemoryArena transient_arena; //Note: per-frame scratch, reset at the end of every PlatformLoop
+		StaticLayerCache static_layer;
+		DirtyRegionTracker dirty_tracker;
+	};
+
 	struct FileResult
 	{
 		u32 content_size;
@@ -211,6 +519,84 @@
 	#define PLATFORM_FREE_FILE(name) void name(ThreadContext& thread, FileResult& file)
 	typedef PLATFORM_FREE_FILE(FuncPlatformFree);
 
+	//Note: entries run on the platform's worker threads, the main thread helps while it waits for completion.
+	//Only the main thread adds entries
+	struct PlatformWorkQueue;
+
+	#define PLATFORM_WORK_QUEUE_CALLBACK(name) void name(PlatformWorkQueue* queue, void* data)
+	typedef PLATFORM_WORK_QUEUE_CALLBACK(FuncPlatformWorkQueueCallback);
+
+	#define PLATFORM_ADD_WORK_ENTRY(name) void name(PlatformWorkQueue* queue, FuncPlatformWorkQueueCallback* callback, void* data)
+	typedef PLATFORM_ADD_WORK_ENTRY(FuncPlatformAddWorkEntry);
+
+	#define PLATFORM_COMPLETE_ALL_WORK(name) void name(PlatformWorkQueue* queue)
+	typedef PLATFORM_COMPLETE_ALL_WORK(FuncPlatformCompleteAllWork);
+
+	extern FuncPlatformAddWorkEntry* global_platform_add_work_entry;
+	extern FuncPlatformCompleteAllWork* global_platform_complete_all_work;
+	extern u32 global_platform_work_thread_count;
+
+	//Note: monotonic, only used for time budgets
+	#define PLATFORM_GET_WALL_CLOCK_MICROSECONDS(name) u64 name()
+	typedef PLATFORM_GET_WALL_CLOCK_MICROSECONDS(FuncPlatformGetWallClockMicroseconds);
+
+	extern FuncPlatformGetWallClockMicroseconds* global_platform_get_wall_clock;
+
+	enum StoragePageMode
+	{
+		StoragePageMode_Normal,
+		StoragePageMode_Huge, //Note: 2MB pages, fewer tlb misses on the scattered entity and chunk data
+	};
+
+	enum DebugCycleCounterType
+	{
+		DebugCycleCounter_PlatformLoop,
+		DebugCycleCounter_SetCamera,
+		DebugCycleCounter_MoveEntities,
+		DebugCycleCounter_EntityResidency,
+
+		DebugCycleCounter_Count,
+	};
+
+	global_static const char* debug_cycle_counter_names[DebugCycleCounter_Count] =
+	{
+		"PlatformLoop",
+		"SetCamera",
+		"MoveEntities",
+		"EntityResidency",
+	};
+
+	struct DebugCycleCounter
+	{
+		u64 cycle_count;
+		u32 hit_count;
+	};
+
+	constexpr u32 DEBUG_CHECK_MAX_COUNT = 32;
+
+	//Note: an optimized path timed and compared against its reference on the same input
+	struct DebugCheckResult
+	{
+		const char* name;
+		u64 reference_cycles;
+		u64 optimized_cycles;
+		u32 mismatch_count; //Note: anything but 0 is a failure
+	};
+
+	//Note: more dirty rectangles than this get merged into each other. Past the fraction of the buffer one full redraw
+	//costs less than the rectangles' bookkeeping and overdraw
+	constexpr u32 DIRTY_RECT_MAX_COUNT = 16;
+	constexpr r32 DIRTY_REGION_FULL_REDRAW_FRACTION = .5f;
+
+	//Note: the part of the buffer the last PlatformLoop wrote, everything outside it is as the platform last presented it
+	struct GameDirtyRegion
+	{
+		b32 is_full; //Note: the whole buffer, rect_count is 0
+		u32 rect_count;
+		Rectangle2i rects[DIRTY_RECT_MAX_COUNT]; //Note: never overlap
+		u64 redrawn_pixel_count;
+	};
+
 	struct GameMemory
 	{
 		b32 is_initialized;
@@ -219,11 +605,52 @@
 		u64 transient_storage_size;
 		void* transient_storage; //Note: required to be zeroed
 
+		//Note: when set, both storages are only reserved and the arenas commit pages as they grow.
+		//Each storage is followed by a guard page that is never committed
+		FuncPlatformCommitMemory* PlatformCommitMemory;
+		StoragePageMode storage_page_mode;
+
 		FuncPlatformRead* Debug_PlatformRead;
 		FuncPlatformWrite* Debug_PlatformWrite;
 		FuncPlatformFree* Debug_PlatformFree;
+
+		FuncPlatformReportArenaOverflow* PlatformReportArenaOverflow;
+		FuncPlatformGetWallClockMicroseconds* PlatformGetWallClockMicroseconds; //Note: optional, budgets fall back to counts
+
+		//Note: optional, without a queue the work runs on the calling thread
+		PlatformWorkQueue* work_queue;
+		u32 work_queue_thread_count; //Note: the worker threads, not counting the thread that completes the work
+		FuncPlatformAddWorkEntry* PlatformAddWorkEntry;
+		FuncPlatformCompleteAllWork* PlatformCompleteAllWork;
+
+		//Note: written by the game each frame, the platform only needs to present what it covers
+		GameDirtyRegion dirty_region;
+
+		//Note: accumulated by the game each frame, read and cleared by the platform
+		DebugCycleCounter counters[DebugCycleCounter_Count];
+
+		//Note: written by the game at the end of each frame, every arena it owns summed per tag. The peaks are that frame's
+		ArenaTagStats arena_tag_stats[ArenaTag_Count];
+
+		//Note: set by the platform to redraw every frame in full, the frames have to come out the same as with dirty rects
+		b32 debug_force_full_redraw;
+
+		//Note: set by the platform, the first PlatformLoop then runs every check once the transient storage is set up
+		b32 debug_run_checks;
+		u32 debug_check_count;
+		DebugCheckResult debug_checks[DEBUG_CHECK_MAX_COUNT];
 	};
 
+	extern GameMemory* debug_global_memory;
+
+	#define BEGIN_TIMED_BLOCK(ID) u64 start_cycle_count_##ID = __rdtsc();
+	#define END_TIMED_BLOCK(ID) \
+		if (debug_global_memory) \
+		{ \
+			debug_global_memory->counters[DebugCycleCounter_##ID].cycle_count += __rdtsc() - start_cycle_count_##ID; \
+			++debug_global_memory->counters[DebugCycleCounter_##ID].hit_count; \
+		}
+
 	#define GAME_LOOP(name) void name(ThreadContext& thread, GameMemory* memory, const GameInput* input, const GameOffscreenBuffer& buffer)
 	typedef GAME_LOOP(FuncPlatformLoop);
 
@@ -3,6 +3,7 @@
 #include "Definition.hpp"
 
 #include "math.h"
+#include "string.h"
 
 inline i32 SignOf(i32 value)
 {
@@ -44,6 +45,34 @@ inline u32 RotateRight(u32 value, i32 amount)
 #endif
 }
 
+//Note: returns the value before the call, the exchange happened when that equals expected. A full barrier
+inline u32 AtomicCompareExchangeU32(u32 volatile* value, u32 new_value, u32 expected)
+{
+#if COMPILER_MSVC
+	return static_cast<u32>(_InterlockedCompareExchange(reinterpret_cast<long volatile*>(value), static_cast<long>(new_value), static_cast<long>(expected)));
+#else
+	return __sync_val_compare_and_swap(value, expected, new_value);
+#endif
+}
+
+//Note: returns the value before the call. A full barrier
+inline u32 AtomicExchangeU32(u32 volatile* value, u32 new_value)
+{
+#if COMPILER_MSVC
+	return static_cast<u32>(_InterlockedExchange(reinterpret_cast<long volatile*>(value), static_cast<long>(new_value)));
+#else
+	return __atomic_exchange_n(value, new_value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+//Note: memcpy is the defined way to read a float's bits, it compiles down to a single move
+inline u32 FloatBits(r32 real)
+{
+	u32 result;
+	memcpy(&result, &real, sizeof(result));
+	return result;
+}
+
 inline i32 RoundToI32(r32 real)
 {
 	return static_cast<i32>(roundf(real));
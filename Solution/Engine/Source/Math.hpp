@@ -127,5 +127,51 @@ inline b32 IsInRectangle(Rectangle rect, V2 a)
 	};
 
 
+	return result;
+}
+
+//Note: pixel rectangle, min inclusive and max exclusive like IsInRectangle
+struct Rectangle2i
+{
+	i32 min_x;
+	i32 min_y;
+	i32 max_x;
+	i32 max_y;
+};
+
+inline Rectangle2i Intersect(Rectangle2i a, Rectangle2i b)
+{
+	Rectangle2i result;
+	result.min_x = (a.min_x > b.min_x) ? a.min_x : b.min_x;
+	result.min_y = (a.min_y > b.min_y) ? a.min_y : b.min_y;
+	result.max_x = (a.max_x < b.max_x) ? a.max_x : b.max_x;
+	result.max_y = (a.max_y < b.max_y) ? a.max_y : b.max_y;
+	return result;
+}
+
+inline Rectangle2i Union(Rectangle2i a, Rectangle2i b)
+{
+	Rectangle2i result;
+	result.min_x = (a.min_x < b.min_x) ? a.min_x : b.min_x;
+	result.min_y = (a.min_y < b.min_y) ? a.min_y : b.min_y;
+	result.max_x = (a.max_x > b.max_x) ? a.max_x : b.max_x;
+	result.max_y = (a.max_y > b.max_y) ? a.max_y : b.max_y;
+	return result;
+}
+
+inline b32 HasArea(Rectangle2i a)
+{
+	b32 result = (a.min_x < a.max_x) && (a.min_y < a.max_y);
+	return result;
+}
+
+//Note: 0 for an empty or inverted rect
+inline i64 GetArea(Rectangle2i a)
+{
+	i64 result = 0;
+	if (HasArea(a))
+	{
+		result = static_cast<i64>(a.max_x - a.min_x) * static_cast<i64>(a.max_y - a.min_y);
+	}
 	return result;
 }
\ No newline at end of file
@@ -0,0 +1,437 @@
+#pragma once
+
+#include "Definition.hpp"
+
+#include <string.h>
+
+constexpr MemoryIndex CACHE_LINE_SIZE = 64;
+constexpr MemoryIndex DEFAULT_ARENA_ALIGNMENT = 8;
+constexpr MemoryIndex PLATFORM_PAGE_SIZE = KiloBytes(4);
+constexpr MemoryIndex ARENA_COMMIT_GRANULARITY = KiloBytes(64);
+
+enum ArenaTag
+{
+	ArenaTag_Untagged,
+	ArenaTag_SubArena,
+	ArenaTag_World,
+	ArenaTag_WorldChunk,
+	ArenaTag_EntityBlock,
+	ArenaTag_FrameScratch,
+	ArenaTag_HighEntity,
+	ArenaTag_RenderCache,
+	ArenaTag_SpriteAtlas,
+
+	ArenaTag_Count,
+};
+
+global_static const char* arena_tag_names[ArenaTag_Count] =
+{
+	"Untagged",
+	"SubArena",
+	"World",
+	"WorldChunk",
+	"EntityBlock",
+	"FrameScratch",
+	"HighEntity",
+	"RenderCache",
+	"SpriteAtlas",
+};
+
+//Note: called in every build when a push does not fit, the game traps as soon as it returns
+#define PLATFORM_REPORT_ARENA_OVERFLOW(name) void name(const char* tag_name, MemoryIndex requested_size, MemoryIndex used, MemoryIndex size)
+typedef PLATFORM_REPORT_ARENA_OVERFLOW(FuncPlatformReportArenaOverflow);
+
+extern FuncPlatformReportArenaOverflow* global_report_arena_overflow; //Note: defined once in EntryPoint.cpp
+
+//Note: makes reserved pages readable and writable, fresh pages read as zero
+#define PLATFORM_COMMIT_MEMORY(name) b32 name(void* base, MemoryIndex size)
+typedef PLATFORM_COMMIT_MEMORY(FuncPlatformCommitMemory);
+
+extern FuncPlatformCommitMemory* global_platform_commit_memory;
+
+struct ArenaTagStats
+{
+	MemoryIndex live; //Note: includes alignment padding
+	MemoryIndex peak;
+	u32 push_count;
+};
+
+struct MemoryArena
+{
+	MemoryIndex size;
+	u8* base;
+	MemoryIndex used;
+
+	u32 temp_count;
+
+	MemoryIndex peak_used;
+	ArenaTagStats tag_stats[ArenaTag_Count];
+
+	u32 overflow_count;
+	ArenaTag overflow_tag;
+
+	b32 commit_on_demand; //Note: the arena only reserves its range, pages get committed as used advances
+	MemoryIndex committed; //Note: everything below is committed, except the ranges handed to sub-arenas
+	u32 sub_arena_count; //Note: carved while committing on demand, each leaves such a range
+};
+
+struct TemporaryMemory
+{
+	MemoryArena* arena;
+	MemoryIndex used;
+	MemoryIndex committed;
+	u32 sub_arena_count;
+	MemoryIndex tag_live[ArenaTag_Count];
+};
+
+enum ArenaPushFlag
+{
+	ArenaFlag_ClearToZero = 0x1,
+	ArenaFlag_NoCommit = 0x2, //Note: reserve only, used when carving sub-arenas
+};
+
+struct ArenaPushParams
+{
+	u32 flags;
+	MemoryIndex alignment;
+};
+
+inline ArenaPushParams DefaultArenaParams()
+{
+	ArenaPushParams params;
+	params.flags = ArenaFlag_ClearToZero;
+	params.alignment = DEFAULT_ARENA_ALIGNMENT;
+	return params;
+}
+
+inline ArenaPushParams AlignNoClear(MemoryIndex alignment)
+{
+	ArenaPushParams params = DefaultArenaParams();
+	params.flags &= ~static_cast<u32>(ArenaFlag_ClearToZero);
+	params.alignment = alignment;
+	return params;
+}
+
+inline ArenaPushParams Align(MemoryIndex alignment, b32 clear)
+{
+	ArenaPushParams params = DefaultArenaParams();
+	if (clear)
+	{
+		params.flags |= ArenaFlag_ClearToZero;
+	}
+	else
+	{
+		params.flags &= ~static_cast<u32>(ArenaFlag_ClearToZero);
+	}
+	params.alignment = alignment;
+	return params;
+}
+
+inline ArenaPushParams NoClear()
+{
+	ArenaPushParams params = DefaultArenaParams();
+	params.flags &= ~static_cast<u32>(ArenaFlag_ClearToZero);
+	return params;
+}
+
+internal_static void InitializeArena(MemoryArena& arena, MemoryIndex size, u8* base, b32 commit_on_demand = false)
+{
+	arena = {};
+	arena.size = size;
+	arena.base = base;
+	arena.commit_on_demand = commit_on_demand;
+}
+
+inline MemoryIndex AlignPow2(MemoryIndex value, MemoryIndex alignment)
+{
+	Assert(alignment && (alignment & (alignment - 1)) == 0);
+	return (value + alignment - 1) & ~(alignment - 1);
+}
+
+inline MemoryIndex GetAlignmentOffset(const MemoryArena& arena, MemoryIndex alignment)
+{
+	Assert(alignment && (alignment & (alignment - 1)) == 0); //power of 2
+
+	MemoryIndex alignment_offset = 0;
+
+	MemoryIndex result_pointer = reinterpret_cast<MemoryIndex>(arena.base) + arena.used;
+	MemoryIndex alignment_mask = alignment - 1;
+	if (result_pointer & alignment_mask)
+	{
+		alignment_offset = alignment - (result_pointer & alignment_mask);
+	}
+
+	return alignment_offset;
+}
+
+//Note: bytes the push will actually consume, including the padding needed to align it
+inline MemoryIndex GetEffectiveSizeFor(const MemoryArena& arena, MemoryIndex size, ArenaPushParams params = DefaultArenaParams())
+{
+	return size + GetAlignmentOffset(arena, params.alignment);
+}
+
+inline MemoryIndex GetArenaSizeRemaining(const MemoryArena& arena, ArenaPushParams params = DefaultArenaParams())
+{
+	return arena.size - (arena.used + GetAlignmentOffset(arena, params.alignment));
+}
+
+inline b32 ArenaHasRoomFor(const MemoryArena& arena, MemoryIndex size, ArenaPushParams params = DefaultArenaParams())
+{
+	return (arena.used + GetEffectiveSizeFor(arena, size, params)) <= arena.size;
+}
+
+inline void ZeroSize(MemoryIndex size, void* ptr)
+{
+	memset(ptr, 0, size);
+}
+
+//Note: never returns, no push hands back a null pointer for its caller to miss
+[[noreturn]] internal_static void ArenaOverflow(MemoryArena& arena, ArenaTag tag, MemoryIndex size)
+{
+	++arena.overflow_count;
+	arena.overflow_tag = tag;
+
+	if (global_report_arena_overflow)
+	{
+		global_report_arena_overflow(arena_tag_names[tag], size, arena.used, arena.size);
+	}
+
+	Trap();
+}
+
+//Note: commits the pages backing [start, end) that are not committed yet, in steps of ARENA_COMMIT_GRANULARITY
+internal_static b32 CommitArenaRange(MemoryArena& arena, MemoryIndex start, MemoryIndex end)
+{
+	b32 result = true;
+
+	if (arena.commit_on_demand && end > arena.committed)
+	{
+		if (start < arena.committed)
+		{
+			start = arena.committed;
+		}
+
+		MemoryIndex commit_end = AlignPow2(end, ARENA_COMMIT_GRANULARITY);
+		if (commit_end > arena.size)
+		{
+			//Note: never reach into the guard page behind the arena
+			commit_end = arena.size;
+		}
+
+		u8* commit_base = reinterpret_cast<u8*>(reinterpret_cast<MemoryIndex>(arena.base + start) & ~(PLATFORM_PAGE_SIZE - 1));
+		u8* commit_limit = arena.base + commit_end;
+
+		result = global_platform_commit_memory &&
+			global_platform_commit_memory(commit_base, static_cast<MemoryIndex>(commit_limit - commit_base));
+
+		if (result)
+		{
+			arena.committed = commit_end;
+		}
+	}
+
+	return result;
+}
+
+internal_static void* PushSize_(MemoryArena& arena, MemoryIndex size_init, ArenaTag tag, ArenaPushParams params = DefaultArenaParams())
+{
+	Assert(tag < ArenaTag_Count);
+
+	MemoryIndex alignment_offset = GetAlignmentOffset(arena, params.alignment);
+	MemoryIndex size = size_init + alignment_offset;
+
+	//Note: kept in release, an overflowing arena must never hand out memory past its end
+	if (arena.used + size > arena.size)
+	{
+		ArenaOverflow(arena, tag, size);
+	}
+
+	if (!(params.flags & ArenaFlag_NoCommit) &&
+		!CommitArenaRange(arena, arena.used + alignment_offset, arena.used + size))
+	{
+		ArenaOverflow(arena, tag, size);
+	}
+
+	void* result = arena.base + arena.used + alignment_offset;
+	arena.used += size;
+
+	if (arena.used > arena.peak_used)
+	{
+		arena.peak_used = arena.used;
+	}
+
+	ArenaTagStats& stats = arena.tag_stats[tag];
+	stats.live += size;
+	++stats.push_count;
+	if (stats.live > stats.peak)
+	{
+		stats.peak = stats.live;
+	}
+
+	if ((params.flags & ArenaFlag_ClearToZero) && !(params.flags & ArenaFlag_NoCommit))
+	{
+		ZeroSize(size_init, result);
+	}
+
+	return result;
+}
+#define PushStruct(Arena, Type, Tag, ...) static_cast<Type*>(PushSize_(Arena, sizeof(Type), Tag __VA_OPT__(,) __VA_ARGS__))
+#define PushArray(Arena, Count, Type, Tag, ...) static_cast<Type*>(PushSize_(Arena, (Count) * sizeof(Type), Tag __VA_OPT__(,) __VA_ARGS__))
+#define PushSize(Arena, Size, Tag, ...) PushSize_(Arena, Size, Tag __VA_OPT__(,) __VA_ARGS__)
+
+//Note: carves a child arena out of the parent, the child is released together with the parent
+internal_static void SubArena(MemoryArena& result, MemoryArena& arena, MemoryIndex size, ArenaTag tag = ArenaTag_SubArena, ArenaPushParams params = AlignNoClear(CACHE_LINE_SIZE))
+{
+	if (arena.commit_on_demand)
+	{
+		//Note: the child gets its own pages, committed as it grows, followed by a guard page that is never committed.
+		//Start past whatever the parent already committed so the guard cannot land on a committed page
+		if (arena.committed > arena.used)
+		{
+			arena.used = arena.committed;
+		}
+
+		size = AlignPow2(size, PLATFORM_PAGE_SIZE);
+		if (params.alignment < PLATFORM_PAGE_SIZE)
+		{
+			params.alignment = PLATFORM_PAGE_SIZE;
+		}
+		params.flags |= ArenaFlag_NoCommit;
+
+		u8* base = static_cast<u8*>(PushSize_(arena, size + PLATFORM_PAGE_SIZE, tag, params));
+		InitializeArena(result, size, base, true);
+		++arena.sub_arena_count;
+	}
+	else
+	{
+		InitializeArena(result, size, static_cast<u8*>(PushSize_(arena, size, tag, params)));
+	}
+}
+
+inline ArenaTagStats GetArenaTagStats(const MemoryArena& arena, ArenaTag tag)
+{
+	Assert(tag < ArenaTag_Count);
+	return arena.tag_stats[tag];
+}
+
+//Note: peaks restart from the current live values, use to measure a single frame or scene
+inline void ResetArenaPeaks(MemoryArena& arena)
+{
+	arena.peak_used = arena.used;
+	for (u32 tag_index = 0; tag_index < ArenaTag_Count; ++tag_index)
+	{
+		arena.tag_stats[tag_index].peak = arena.tag_stats[tag_index].live;
+	}
+}
+
+//Note: everything pushed after Begin is released in O(1) by End, scopes must nest
+internal_static TemporaryMemory BeginTemporaryMemory(MemoryArena& arena)
+{
+	TemporaryMemory result;
+	result.arena = &arena;
+	result.used = arena.used;
+	result.committed = arena.committed;
+	result.sub_arena_count = arena.sub_arena_count;
+	for (u32 tag_index = 0; tag_index < ArenaTag_Count; ++tag_index)
+	{
+		result.tag_live[tag_index] = arena.tag_stats[tag_index].live;
+	}
+
+	++arena.temp_count;
+
+	return result;
+}
+
+internal_static void EndTemporaryMemory(TemporaryMemory& temp_memory)
+{
+	MemoryArena& arena = *temp_memory.arena;
+	Assert(arena.used >= temp_memory.used);
+	arena.used = temp_memory.used;
+
+	//Note: sub-arenas carved in the block start past what was committed when it began and leave their range
+	//uncommitted, so only that much is known to be committed once the block is handed back
+	if (arena.sub_arena_count != temp_memory.sub_arena_count)
+	{
+		arena.committed = temp_memory.committed;
+		arena.sub_arena_count = temp_memory.sub_arena_count;
+	}
+	for (u32 tag_index = 0; tag_index < ArenaTag_Count; ++tag_index)
+	{
+		arena.tag_stats[tag_index].live = temp_memory.tag_live[tag_index];
+	}
+
+	Assert(arena.temp_count > 0);
+	--arena.temp_count;
+}
+
+//Note: call at the end of the frame, every BeginTemporaryMemory needs a matching End
+internal_static void CheckArena(const MemoryArena& arena)
+{
+	Assert(arena.temp_count == 0);
+}
+
+struct FreeListNode
+{
+	FreeListNode* next;
+};
+
+//Note: typed free list on top of an arena, released items are recycled before the arena grows
+template<typename T>
+struct FreeListPool
+{
+	MemoryArena* arena;
+	ArenaTag tag;
+	FreeListNode* first_free;
+
+	u32 allocated_count; //Note: items ever pushed onto the arena
+	u32 free_count;
+};
+
+template<typename T>
+internal_static void InitializePool(FreeListPool<T>& pool, MemoryArena& arena, ArenaTag tag)
+{
+	static_assert(sizeof(T) >= sizeof(FreeListNode), "pooled type must be able to hold a free list link");
+
+	pool.arena = &arena;
+	pool.tag = tag;
+	pool.first_free = nullptr;
+	pool.allocated_count = 0;
+	pool.free_count = 0;
+}
+
+//Note: memory returned is always zeroed
+template<typename T>
+internal_static T* AcquireFromPool(FreeListPool<T>& pool)
+{
+	T* result;
+
+	if (pool.first_free)
+	{
+		FreeListNode* node = pool.first_free;
+		pool.first_free = node->next;
+		--pool.free_count;
+
+		result = reinterpret_cast<T*>(node);
+		ZeroSize(sizeof(T), result);
+	}
+	else
+	{
+		result = PushStruct(*pool.arena, T, pool.tag, Align(alignof(T), true));
+		++pool.allocated_count;
+	}
+
+	return result;
+}
+
+template<typename T>
+internal_static void ReleaseToPool(FreeListPool<T>& pool, T* item)
+{
+	Assert(item);
+
+	FreeListNode* node = reinterpret_cast<FreeListNode*>(item);
+	node->next = pool.first_free;
+	pool.first_free = node;
+	++pool.free_count;
+
+	Assert(pool.free_count <= pool.allocated_count);
+}
@@ -0,0 +1,171 @@
+#include "SpriteAtlas.hpp"
+
+#include "Core.hpp"
+#include "EntryPoint.hpp"
+
+constexpr u64 FNV_OFFSET_BASIS = 0xcbf29ce484222325ull;
+constexpr u64 FNV_PRIME = 0x100000001b3ull;
+
+//Note: fnv-1a, chained through hash so several spans can go into one value
+inline u64 HashBytes(u64 hash, const void* data, MemoryIndex size)
+{
+	const u8* bytes = static_cast<const u8*>(data);
+	for (MemoryIndex byte_index = 0; byte_index < size; ++byte_index)
+	{
+		hash = (hash ^ bytes[byte_index]) * FNV_PRIME;
+	}
+
+	return hash;
+}
+
+//Note: the pixels are cleared, so the padding around each sprite is transparent
+internal_static void InitializeSpriteAtlas(SpriteAtlas& atlas, MemoryArena& arena, i32 width, i32 height)
+{
+	Assert(width % SPRITE_ATLAS_ALIGNMENT == 0);
+	Assert(static_cast<u32>(width / SPRITE_ATLAS_ALIGNMENT) <= SPRITE_ATLAS_MAX_SKYLINE_NODE_COUNT);
+
+	atlas = {};
+	atlas.width = width;
+	atlas.height = height;
+	atlas.pixels = PushArray(arena, static_cast<MemoryIndex>(width * height), u32, ArenaTag_SpriteAtlas, Align(CACHE_LINE_SIZE, true));
+
+	atlas.node_count = 1;
+	atlas.nodes[0] = { 0, 0, width };
+}
+
+inline void RemoveSkylineNode(SpriteAtlas& atlas, u32 node_index)
+{
+	--atlas.node_count;
+	for (u32 index = node_index; index < atlas.node_count; ++index)
+	{
+		atlas.nodes[index] = atlas.nodes[index + 1];
+	}
+}
+
+//Note: finds the lowest spot a width by height rect fits, ties going to the leftmost, and raises the skyline over it.
+//Returns false when the atlas is full
+internal_static b32 PackSpriteAtlasRect(SpriteAtlas& atlas, i32 width, i32 height, i32& out_x, i32& out_y)
+{
+	i32 padded_width = static_cast<i32>(AlignPow2(static_cast<MemoryIndex>(width), SPRITE_ATLAS_ALIGNMENT));
+
+	b32 found = false;
+	u32 best_index = 0;
+	i32 best_x = 0;
+	i32 best_y = 0;
+	for (u32 node_index = 0; node_index < atlas.node_count; ++node_index)
+	{
+		i32 x = atlas.nodes[node_index].x;
+		if (x + padded_width <= atlas.width)
+		{
+			//Note: the rect rests on the highest node under it
+			i32 y = 0;
+			i32 remaining_width = padded_width;
+			for (u32 span_index = node_index; remaining_width > 0; ++span_index)
+			{
+				Assert(span_index < atlas.node_count);
+				y = Maximum(y, atlas.nodes[span_index].y);
+				remaining_width -= atlas.nodes[span_index].width;
+			}
+
+			if (y + height <= atlas.height && (!found || y < best_y))
+			{
+				found = true;
+				best_index = node_index;
+				best_x = x;
+				best_y = y;
+			}
+		}
+	}
+
+	//Note: placing the rect inserts its node before the ones it covers are cut away, without room for it the atlas is full
+	if (atlas.node_count >= SPRITE_ATLAS_MAX_SKYLINE_NODE_COUNT)
+	{
+		found = false;
+	}
+
+	if (found)
+	{
+		for (u32 index = atlas.node_count; index > best_index; --index)
+		{
+			atlas.nodes[index] = atlas.nodes[index - 1];
+		}
+		++atlas.node_count;
+		atlas.nodes[best_index] = { best_x, best_y + height, padded_width };
+
+		//Note: the nodes the rect now covers are cut back to where it ends
+		i32 covered_end = best_x + padded_width;
+		u32 next_index = best_index + 1;
+		while (next_index < atlas.node_count && atlas.nodes[next_index].x < covered_end)
+		{
+			SkylineNode& node = atlas.nodes[next_index];
+			i32 shrink = covered_end - node.x;
+			if (node.width <= shrink)
+			{
+				RemoveSkylineNode(atlas, next_index);
+			}
+			else
+			{
+				node.x += shrink;
+				node.width -= shrink;
+			}
+		}
+
+		for (u32 index = 0; index + 1 < atlas.node_count;)
+		{
+			if (atlas.nodes[index].y == atlas.nodes[index + 1].y)
+			{
+				atlas.nodes[index].width += atlas.nodes[index + 1].width;
+				RemoveSkylineNode(atlas, index + 1);
+			}
+			else
+			{
+				++index;
+			}
+		}
+
+		out_x = best_x;
+		out_y = best_y;
+	}
+
+	return found;
+}
+
+//Note: nullptr when no sprite of this size and hash has been added. A hit is only a candidate, the caller compares its
+//pixels before reusing it
+internal_static const LoadedBitmap* FindAtlasSprite(const SpriteAtlas& atlas, u64 content_hash, i32 width, i32 height)
+{
+	const LoadedBitmap* result = nullptr;
+	for (u32 sprite_index = 0; sprite_index < atlas.sprite_count && !result; ++sprite_index)
+	{
+		const AtlasSprite& sprite = atlas.sprites[sprite_index];
+		if (sprite.content_hash == content_hash && sprite.bitmap.width == width && sprite.bitmap.height == height)
+		{
+			result = &atlas.sprites[sprite_index].bitmap;
+		}
+	}
+
+	return result;
+}
+
+//Note: reserves room for a width by height sprite, the caller fills in its rows. The returned view has no pixels
+//when the atlas is full, either out of room or out of sprites
+internal_static LoadedBitmap AddAtlasSprite(SpriteAtlas& atlas, u64 content_hash, i32 width, i32 height)
+{
+	LoadedBitmap result{};
+
+	i32 x = 0;
+	i32 y = 0;
+	if (atlas.sprite_count < ArrayCount(atlas.sprites) && PackSpriteAtlasRect(atlas, width, height, x, y))
+	{
+		result.width = width;
+		result.height = height;
+		result.pitch = atlas.width;
+		result.pixels = atlas.pixels + y * atlas.width + x;
+
+		AtlasSprite& sprite = atlas.sprites[atlas.sprite_count++];
+		sprite.content_hash = content_hash;
+		sprite.bitmap = result;
+	}
+
+	return result;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Definition.hpp"
+#include "Memory.hpp"
+
+//Note: a view into a sprite atlas. Rows are stored bottom-up, row r starts at pixels + r * pitch
+struct LoadedBitmap
+{
+	i32 width;
+	i32 height;
+	i32 pitch; //Note: in pixels, the width of the atlas the bitmap lives in
+	u32* pixels;
+};
+
+constexpr i32 SPRITE_ATLAS_ALIGNMENT = 16; //Note: in pixels, a cache line. Sprites start on one and their widths are rounded up to one
+constexpr u32 SPRITE_ATLAS_MAX_SKYLINE_NODE_COUNT = 128;
+constexpr u32 SPRITE_ATLAS_MAX_SPRITE_COUNT = 64;
+
+//Note: the atlas is filled up to y over [x, x + width)
+struct SkylineNode
+{
+	i32 x;
+	i32 y;
+	i32 width;
+};
+
+struct AtlasSprite
+{
+	u64 content_hash; //Note: of the source image as read, before it is swizzled
+	LoadedBitmap bitmap;
+};
+
+//Note: sprites are packed as they are loaded, each into the lowest spot of the skyline it fits, leftmost first.
+//An image that is already in the atlas is not stored again, its view is handed out instead
+struct SpriteAtlas
+{
+	i32 width;
+	i32 height;
+	u32* pixels;
+
+	u32 node_count;
+	SkylineNode nodes[SPRITE_ATLAS_MAX_SKYLINE_NODE_COUNT];
+
+	u32 sprite_count;
+	AtlasSprite sprites[SPRITE_ATLAS_MAX_SPRITE_COUNT];
+};
@@ -4,10 +4,7 @@
 #include "Intrinsics.hpp"
 #include "EntryPoint.hpp"
 
-struct MemoryArena;
-
 constexpr i32 TILE_CHUNK_SAFE_MARGIN = INT32_MAX / 64;
-constexpr i32 TILE_CHUNK_UNINITIALIZED = INT32_MAX;
 
 internal_static void InitializeTileMap(World& tile_map, r32 tile_side_in_meters)
 {
@@ -18,54 +15,219 @@ internal_static void InitializeTileMap(World& tile_map, r32 tile_side_in_meters)
 
 	tile_map.tile_side_in_meters = tile_side_in_meters;
 
-	for (u32 tile_chunk_index = 0; tile_chunk_index < ArrayCount(tile_map.tile_chunk_hash); ++tile_chunk_index)
-	{
-		tile_map.tile_chunk_hash[tile_chunk_index].chunk_x = TILE_CHUNK_UNINITIALIZED;
-	}
+	InitializePool(tile_map.chunk_pool, tile_map.arena, ArenaTag_WorldChunk);
+	InitializePool(tile_map.entity_block_pool, tile_map.arena, ArenaTag_EntityBlock);
 }
-internal_static WorldChunk* GetTileChunk(World& tile_map, i32 tile_chunk_x, i32 tile_chunk_y, i32 tile_chunk_z, MemoryArena* arena = nullptr)
-{
-	Assert(tile_chunk_x > -TILE_CHUNK_SAFE_MARGIN || tile_chunk_y > -TILE_CHUNK_SAFE_MARGIN || tile_chunk_z > -TILE_CHUNK_SAFE_MARGIN);
-	Assert(tile_chunk_x < TILE_CHUNK_SAFE_MARGIN || tile_chunk_y < TILE_CHUNK_SAFE_MARGIN || tile_chunk_z < TILE_CHUNK_SAFE_MARGIN);
 
+inline WorldChunk** GetTileChunkHashSlot(World& tile_map, i32 tile_chunk_x, i32 tile_chunk_y, i32 tile_chunk_z)
+{
 	u32 hash_value = static_cast<u32>(19 * tile_chunk_x + 7 * tile_chunk_y + 3 * tile_chunk_z);
 	u32 hash_slot = hash_value & (ArrayCount(tile_map.tile_chunk_hash) - 1);
 	Assert(hash_slot < ArrayCount(tile_map.tile_chunk_hash));
 
-	WorldChunk* chunk = tile_map.tile_chunk_hash + hash_slot;
-	do
+	return tile_map.tile_chunk_hash + hash_slot;
+}
+
+inline b32 IsChunkAt(const WorldChunk& chunk, i32 tile_chunk_x, i32 tile_chunk_y, i32 tile_chunk_z)
+{
+	return chunk.chunk_x == tile_chunk_x && chunk.chunk_y == tile_chunk_y && chunk.chunk_z == tile_chunk_z;
+}
+
+internal_static WorldChunk* GetTileChunk(World& tile_map, i32 tile_chunk_x, i32 tile_chunk_y, i32 tile_chunk_z, b32 create = false)
+{
+	Assert(tile_chunk_x > -TILE_CHUNK_SAFE_MARGIN || tile_chunk_y > -TILE_CHUNK_SAFE_MARGIN || tile_chunk_z > -TILE_CHUNK_SAFE_MARGIN);
+	Assert(tile_chunk_x < TILE_CHUNK_SAFE_MARGIN || tile_chunk_y < TILE_CHUNK_SAFE_MARGIN || tile_chunk_z < TILE_CHUNK_SAFE_MARGIN);
+
+	WorldChunk** link = GetTileChunkHashSlot(tile_map, tile_chunk_x, tile_chunk_y, tile_chunk_z);
+	WorldChunk* chunk = *link;
+	while (chunk && !IsChunkAt(*chunk, tile_chunk_x, tile_chunk_y, tile_chunk_z))
 	{
-		if (tile_chunk_x == chunk->chunk_x &&
-			tile_chunk_y == chunk->chunk_y &&
-			tile_chunk_z == chunk->chunk_z)
+		link = &chunk->next_in_hash;
+		chunk = *link;
+	}
+
+	if (!chunk && create)
+	{
+		//Note: appended, so chains keep the order the chunks were created in
+		chunk = AcquireFromPool(tile_map.chunk_pool);
+		chunk->chunk_x = tile_chunk_x;
+		chunk->chunk_y = tile_chunk_y;
+		chunk->chunk_z = tile_chunk_z;
+		*link = chunk;
+	}
+
+	return chunk;
+}
+
+internal_static void ReleaseEntityBlocks(World& tile_map, WorldEntityBlock& first_block)
+{
+	WorldEntityBlock* block = first_block.next;
+	while (block)
+	{
+		WorldEntityBlock* next = block->next;
+		ReleaseToPool(tile_map.entity_block_pool, block);
+		block = next;
+	}
+
+	first_block.entity_count = 0;
+	first_block.next = nullptr;
+}
+
+//Note: unlinks the chunk from its hash chain and recycles it together with its entity blocks
+internal_static void ReleaseTileChunk(World& tile_map, WorldChunk* chunk)
+{
+	Assert(chunk);
+
+	WorldChunk** link = GetTileChunkHashSlot(tile_map, chunk->chunk_x, chunk->chunk_y, chunk->chunk_z);
+	while (*link != chunk)
+	{
+		Assert(*link);
+		link = &(*link)->next_in_hash;
+	}
+	*link = chunk->next_in_hash;
+
+	ReleaseEntityBlocks(tile_map, chunk->first_block);
+	ReleaseToPool(tile_map.chunk_pool, chunk);
+}
+
+inline b32 AreInSameChunk(World& world, WorldPosition& a, WorldPosition& b)
+{
+	b32 result = ((a.tile_x >> world.chunk_shift) == (b.tile_x >> world.chunk_shift) &&
+		(a.tile_y >> world.chunk_shift) == (b.tile_y >> world.chunk_shift) &&
+		a.tile_z == b.tile_z);
+	return result;
+}
+
+inline WorldChunk* GetTileChunkFor(World& world, WorldPosition& position, b32 create = false)
+{
+	return GetTileChunk(world, position.tile_x >> world.chunk_shift, position.tile_y >> world.chunk_shift, position.tile_z, create);
+}
+
+//Note: keeps the entity listed in the entity blocks of the chunk it stands in, old_position is null for a new entity
+//and new_position is null for a deleted one. The first block of a chunk is always the one with free space, full blocks are pushed behind it
+internal_static void ChangeEntityLocation(World& world, u32 low_entity_index, WorldPosition* old_position, WorldPosition* new_position)
+{
+	if (old_position && new_position && AreInSameChunk(world, *old_position, *new_position))
+	{
+		return;
+	}
+
+	if (old_position)
+	{
+		WorldChunk* chunk = GetTileChunkFor(world, *old_position);
+		Assert(chunk);
+		if (chunk)
 		{
-			break;
+			WorldEntityBlock& first_block = chunk->first_block;
+
+			//Note: block only advances while nothing was found, the block after the first may have just been released
+			b32 found = false;
+			WorldEntityBlock* block = &first_block;
+			while (block && !found)
+			{
+				for (u32 index = 0; index < block->entity_count && !found; ++index)
+				{
+					if (block->low_entity_index[index] == low_entity_index)
+					{
+						Assert(first_block.entity_count > 0);
+						block->low_entity_index[index] = first_block.low_entity_index[--first_block.entity_count];
+
+						if (first_block.entity_count == 0 && first_block.next)
+						{
+							WorldEntityBlock* next = first_block.next;
+							first_block = *next;
+							ReleaseToPool(world.entity_block_pool, next);
+						}
+
+						found = true;
+					}
+				}
+
+				if (!found)
+				{
+					block = block->next;
+				}
+			}
+			Assert(found);
+
+			if (first_block.entity_count == 0)
+			{
+				//Note: nothing holds chunk pointers across calls, an emptied chunk goes straight back to the pool
+				ReleaseTileChunk(world, chunk);
+			}
 		}
+	}
+
+	if (new_position)
+	{
+		WorldChunk* chunk = GetTileChunkFor(world, *new_position, true);
+		Assert(chunk);
 
-		if (arena && chunk->chunk_x != TILE_CHUNK_UNINITIALIZED && !chunk->next_in_hash)
+		WorldEntityBlock& first_block = chunk->first_block;
+		if (first_block.entity_count == ArrayCount(first_block.low_entity_index))
 		{
-			chunk->next_in_hash = PushStruct(*arena, WorldChunk);
-			chunk = chunk->next_in_hash;
-			chunk->chunk_x = TILE_CHUNK_UNINITIALIZED;
+			WorldEntityBlock* full_block = AcquireFromPool(world.entity_block_pool);
+			*full_block = first_block;
+
+			first_block.entity_count = 0;
+			first_block.next = full_block;
 		}
 
-		if (arena && chunk->chunk_x == TILE_CHUNK_UNINITIALIZED)
+		Assert(first_block.entity_count < ArrayCount(first_block.low_entity_index));
+		first_block.low_entity_index[first_block.entity_count++] = low_entity_index;
+	}
+}
+
+struct Debug_ChunkSoakResult
+{
+	u32 chunks_visited;
+	MemoryIndex arena_used_after_warmup;
+	MemoryIndex arena_used_at_end;
+	u32 pooled_chunk_count;
+	u32 growth_count; //Note: columns past the warmup that still grew the arena
+};
+
+//Note: soak test, sweeps a window three columns wide and window_height tall across the world until
+//chunk_count chunks have been visited, the leading column is created and the trailing one released.
+//The window is taller than the hash so chains form, world.arena.used has to stay flat once the pool is warm
+internal_static Debug_ChunkSoakResult Debug_SoakTileChunks(World& tile_map, u32 chunk_count, i32 window_height = 2048)
+{
+	Debug_ChunkSoakResult result{};
+
+	i32 column_count = static_cast<i32>(chunk_count) / window_height;
+	i32 warmup_columns = 4;
+
+	for (i32 camera_chunk_x = 0; camera_chunk_x < column_count; ++camera_chunk_x)
+	{
+		MemoryIndex used_before_column = tile_map.arena.used;
+		for (i32 chunk_y = 0; chunk_y < window_height; ++chunk_y)
 		{
-			i32 tile_count = tile_map.chunk_dimension * tile_map.chunk_dimension;
+			WorldChunk* created = GetTileChunk(tile_map, camera_chunk_x + 1, chunk_y, 0, true);
+			Assert(created);
 
-			chunk->chunk_x = tile_chunk_x;
-			chunk->chunk_y = tile_chunk_y;
-			chunk->chunk_z = tile_chunk_z;
+			WorldChunk* trailing = GetTileChunk(tile_map, camera_chunk_x - 2, chunk_y, 0);
+			if (trailing)
+			{
+				ReleaseTileChunk(tile_map, trailing);
+			}
 
-			chunk->next_in_hash = nullptr;
+			++result.chunks_visited;
+		}
 
-			break;
+		if (camera_chunk_x + 1 == warmup_columns)
+		{
+			result.arena_used_after_warmup = tile_map.arena.used;
+		}
+		else if (camera_chunk_x + 1 > warmup_columns && tile_map.arena.used != used_before_column)
+		{
+			++result.growth_count;
 		}
+	}
 
-		chunk = chunk->next_in_hash;
-	} while (chunk);
+	result.arena_used_at_end = tile_map.arena.used;
+	result.pooled_chunk_count = tile_map.chunk_pool.allocated_count;
 
-	return chunk;
+	return result;
 }
 
 #if 0
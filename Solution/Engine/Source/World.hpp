@@ -2,6 +2,7 @@
 
 #include "Definition.hpp"
 #include "Math.hpp"
+#include "Memory.hpp"
 
 
 struct WorldPosition
@@ -47,7 +48,12 @@ struct World
 	i32 chunk_shift;
 	i32 chunk_mask;
 	i32 chunk_dimension;
-	WorldChunk tile_chunk_hash[4096];
+
+	MemoryArena arena; //Note: chunks and overflow entity blocks
+	FreeListPool<WorldChunk> chunk_pool;
+	FreeListPool<WorldEntityBlock> entity_block_pool;
+
+	WorldChunk* tile_chunk_hash[4096]; //Note: every chunk comes from the pool, a chain is relinked when one is released
 };
 
 struct WorldDifference
@@ -0,0 +1,691 @@
+// Headless Linux host: the reserve-then-commit memory scheme and the work queue of PlatformWindows.cpp, driving the game
+// with a scripted controller for a fixed number of frames. There is no window or sound, it exists to run and measure the
+// game on Linux. Run from Engine/Resource so the test bitmaps are found:
+//   Game --frames 600                    run and print a hash of the last frame
+//   Game --frames 200 --check-resident   fail unless resident memory stays within what the game committed
+//   Game --frames 600 --huge             back the game storage with huge pages where the kernel allows it
+//   Game --frames 600 --compare-pages    run with normal then huge pages and print the timed blocks of both once
+//   Game --frames 600 --compare-dirty    run with dirty rects then with full redraws, print the pixels and timed blocks of both
+//   Game --frames 600 --threads 3        hand the tiled rendering and the mover stage to a work queue with 3 workers
+//   Game --frames 1 --check --threads 3  run every optimized path against its reference, fail on any mismatch
+//
+#if defined(__linux__)
+
+#include "Source/EntryPoint.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <semaphore.h>
+
+extern "C" GAME_LOOP(PlatformLoop);
+
+constexpr u64 LinuxStorageGuardSize = KiloBytes(64); //Note: reserved but never committed, one after each storage
+constexpr u64 LinuxHugePageSize = MegaBytes(2);
+constexpr u64 LinuxResidentSlack = MegaBytes(8); //Note: allowed on top of committed storage, the libc heap and file reads
+constexpr i32 LinuxBufferWidth = 960;
+constexpr i32 LinuxBufferHeight = 540;
+
+global_static u64 global_linux_committed_bytes; //Note: pages committed for the first time, see Linux_CommitMemory
+
+struct PlatformWorkQueueEntry
+{
+	FuncPlatformWorkQueueCallback* callback;
+	void* data;
+};
+
+//Note: same ring as the win32 queue, the atomics are the gcc/clang builtins
+struct PlatformWorkQueue
+{
+	u32 volatile completion_goal;
+	u32 volatile completion_count;
+
+	u32 volatile next_entry_to_write;
+	u32 volatile next_entry_to_read;
+	sem_t semaphore;
+
+	PlatformWorkQueueEntry entries[256];
+};
+
+struct Linux_MemoryBlock
+{
+	void* base;
+	u64 size;
+
+	StoragePageMode page_mode;
+	b32 commit_on_demand; //Note: false when the block is already readable and writable
+
+	//Note: one bit per page, set once the page is committed. Arenas commit a page again after a temporary block
+	//rolls them back, only the first commit counts
+	u64* committed_pages;
+	u64 committed_pages_size;
+};
+
+global_static Linux_MemoryBlock* global_linux_commit_block;
+
+//Note: PROT_NONE keeps the whole range unbacked and faulting until the game commits it
+internal_static void* Linux_ReserveMemory(void* base_address, u64 size)
+{
+	void* result = mmap(base_address, size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	return (result == MAP_FAILED) ? nullptr : result;
+}
+
+PLATFORM_COMMIT_MEMORY(Linux_CommitMemory)
+{
+	//Note: anonymous pages read as zero and only become resident when first written
+	b32 result = mprotect(base, size, PROT_READ | PROT_WRITE) == 0;
+	Linux_MemoryBlock* block = global_linux_commit_block;
+	if (result && block && block->committed_pages)
+	{
+		u64 first_page = static_cast<u64>(static_cast<u8*>(base) - static_cast<u8*>(block->base)) / PLATFORM_PAGE_SIZE;
+		u64 end_page = (static_cast<u64>(static_cast<u8*>(base) - static_cast<u8*>(block->base)) + size + PLATFORM_PAGE_SIZE - 1) / PLATFORM_PAGE_SIZE;
+		for (u64 page = first_page; page < end_page; ++page)
+		{
+			u64 bit = 1ull << (page % 64);
+			if (!(block->committed_pages[page / 64] & bit))
+			{
+				block->committed_pages[page / 64] |= bit;
+				global_linux_committed_bytes += PLATFORM_PAGE_SIZE;
+			}
+		}
+	}
+
+	return result;
+}
+
+internal_static void Linux_ReleaseMemory(Linux_MemoryBlock& block)
+{
+	if (block.base)
+	{
+		munmap(block.base, block.size);
+	}
+	if (block.committed_pages)
+	{
+		munmap(block.committed_pages, block.committed_pages_size);
+	}
+	if (global_linux_commit_block == &block)
+	{
+		global_linux_commit_block = nullptr;
+	}
+
+	block = {};
+}
+
+//Note: explicit hugetlbfs pages are taken from the preallocated pool (vm.nr_hugepages) and fully backed up front,
+//transparent huge pages only need madvise and are still faulted in lazily by the kernel
+internal_static void* Linux_ReserveHugePages(void* base_address, u64& size)
+{
+	u64 huge_size = (size + LinuxHugePageSize - 1) & ~(LinuxHugePageSize - 1);
+
+	void* result = mmap(base_address, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+	if (result != MAP_FAILED)
+	{
+		size = huge_size;
+		return result;
+	}
+
+	result = mmap(base_address, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (result == MAP_FAILED)
+	{
+		return nullptr;
+	}
+
+	if (madvise(result, huge_size, MADV_HUGEPAGE) != 0)
+	{
+		munmap(result, huge_size);
+		return nullptr;
+	}
+
+	size = huge_size;
+	return result;
+}
+
+//Note: lays out [permanent][guard][transient][guard] the same way the windows layer does.
+//Huge pages fall back to the normal reserve when the kernel refuses them; guards are only protected in normal mode
+internal_static Linux_MemoryBlock Linux_ReserveGameStorage(void* base_address, u64 permanent_storage_size, u64 transient_storage_size,
+	void*& permanent_storage, void*& transient_storage, StoragePageMode page_mode = StoragePageMode_Normal)
+{
+	Linux_MemoryBlock result{};
+	result.size = permanent_storage_size + LinuxStorageGuardSize + transient_storage_size + LinuxStorageGuardSize;
+
+	if (page_mode == StoragePageMode_Huge)
+	{
+		result.base = Linux_ReserveHugePages(base_address, result.size);
+		if (result.base)
+		{
+			result.page_mode = StoragePageMode_Huge;
+			result.commit_on_demand = false;
+		}
+		else
+		{
+			result.size = permanent_storage_size + LinuxStorageGuardSize + transient_storage_size + LinuxStorageGuardSize;
+		}
+	}
+
+	if (!result.base)
+	{
+		result.base = Linux_ReserveMemory(base_address, result.size);
+		result.page_mode = StoragePageMode_Normal;
+		result.commit_on_demand = true;
+	}
+
+	if (result.base && result.commit_on_demand)
+	{
+		result.committed_pages_size = (result.size / PLATFORM_PAGE_SIZE + 63) / 64 * sizeof(u64);
+		void* committed_pages = mmap(nullptr, result.committed_pages_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		result.committed_pages = (committed_pages == MAP_FAILED) ? nullptr : static_cast<u64*>(committed_pages);
+	}
+
+	if (result.base)
+	{
+		permanent_storage = result.base;
+		transient_storage = static_cast<u8*>(result.base) + permanent_storage_size + LinuxStorageGuardSize;
+	}
+	else
+	{
+		result = {};
+		permanent_storage = nullptr;
+		transient_storage = nullptr;
+	}
+
+	return result;
+}
+
+PLATFORM_GET_WALL_CLOCK_MICROSECONDS(Linux_GetWallClockMicroseconds)
+{
+	timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return static_cast<u64>(now.tv_sec) * 1000000 + static_cast<u64>(now.tv_nsec) / 1000;
+}
+
+PLATFORM_ADD_WORK_ENTRY(Linux_AddWorkEntry)
+{
+	u32 new_next_entry_to_write = (queue->next_entry_to_write + 1) % ArrayCount(queue->entries);
+	Assert(new_next_entry_to_write != __atomic_load_n(&queue->next_entry_to_read, __ATOMIC_ACQUIRE));
+
+	PlatformWorkQueueEntry& entry = queue->entries[queue->next_entry_to_write];
+	entry.callback = callback;
+	entry.data = data;
+	queue->completion_goal = queue->completion_goal + 1; //Note: only this thread writes it
+
+	//Note: the entry has to be visible before the index that publishes it
+	__atomic_store_n(&queue->next_entry_to_write, new_next_entry_to_write, __ATOMIC_RELEASE);
+	sem_post(&queue->semaphore);
+}
+
+//Note: returns true when there was nothing to do
+internal_static b32 Linux_DoNextWorkQueueEntry(PlatformWorkQueue* queue)
+{
+	b32 should_sleep = false;
+
+	u32 original_next_entry_to_read = __atomic_load_n(&queue->next_entry_to_read, __ATOMIC_ACQUIRE);
+	u32 new_next_entry_to_read = (original_next_entry_to_read + 1) % ArrayCount(queue->entries);
+	if (original_next_entry_to_read != __atomic_load_n(&queue->next_entry_to_write, __ATOMIC_ACQUIRE))
+	{
+		if (__atomic_compare_exchange_n(&queue->next_entry_to_read, &original_next_entry_to_read, new_next_entry_to_read,
+			false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+		{
+			PlatformWorkQueueEntry entry = queue->entries[original_next_entry_to_read];
+			entry.callback(queue, entry.data);
+			__atomic_fetch_add(&queue->completion_count, 1, __ATOMIC_RELEASE);
+		}
+	}
+	else
+	{
+		should_sleep = true;
+	}
+
+	return should_sleep;
+}
+
+//Note: the calling thread works through the queue too instead of just waiting
+PLATFORM_COMPLETE_ALL_WORK(Linux_CompleteAllWork)
+{
+	while (queue->completion_goal != __atomic_load_n(&queue->completion_count, __ATOMIC_ACQUIRE))
+	{
+		Linux_DoNextWorkQueueEntry(queue);
+	}
+
+	queue->completion_goal = 0;
+	queue->completion_count = 0;
+}
+
+internal_static void* Linux_WorkQueueThreadProc(void* parameter)
+{
+	PlatformWorkQueue* queue = static_cast<PlatformWorkQueue*>(parameter);
+	for (;;)
+	{
+		if (Linux_DoNextWorkQueueEntry(queue))
+		{
+			sem_wait(&queue->semaphore);
+		}
+	}
+
+	return nullptr;
+}
+
+//Note: the workers are detached and run until the process exits
+internal_static void Linux_MakeWorkQueue(PlatformWorkQueue& queue, u32 thread_count)
+{
+	queue.completion_goal = 0;
+	queue.completion_count = 0;
+	queue.next_entry_to_write = 0;
+	queue.next_entry_to_read = 0;
+	sem_init(&queue.semaphore, 0, 0);
+
+	for (u32 thread_index = 0; thread_index < thread_count; ++thread_index)
+	{
+		pthread_t thread;
+		if (pthread_create(&thread, nullptr, Linux_WorkQueueThreadProc, &queue) == 0)
+		{
+			pthread_detach(thread);
+		}
+	}
+}
+
+//Note: resident set of the whole process, read from /proc/self/statm
+internal_static u64 Linux_GetResidentBytes()
+{
+	u64 result = 0;
+
+	FILE* statm = fopen("/proc/self/statm", "r");
+	if (statm)
+	{
+		unsigned long long total_pages = 0;
+		unsigned long long resident_pages = 0;
+		if (fscanf(statm, "%llu %llu", &total_pages, &resident_pages) == 2)
+		{
+			result = static_cast<u64>(resident_pages) * static_cast<u64>(sysconf(_SC_PAGESIZE));
+		}
+		fclose(statm);
+	}
+
+	return result;
+}
+
+PLATFORM_READ_FILE(Linux_ReadFile)
+{
+	FileResult result = {};
+
+	int file_handle = open(file_name, O_RDONLY);
+	if (file_handle >= 0)
+	{
+		struct stat file_status;
+		if (fstat(file_handle, &file_status) == 0 && file_status.st_size > 0)
+		{
+			const u32 file_size_32 = SafeTruncate32(file_status.st_size);
+			void* content = mmap(nullptr, file_size_32, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (content != MAP_FAILED)
+			{
+				if (read(file_handle, content, file_size_32) == static_cast<ssize_t>(file_size_32))
+				{
+					result.content = content;
+					result.content_size = file_size_32;
+				}
+				else
+				{
+					munmap(content, file_size_32);
+				}
+			}
+		}
+
+		close(file_handle);
+	}
+
+	return result;
+}
+
+PLATFORM_WRITE_FILE(Linux_WriteFile)
+{
+	b32 result = false;
+
+	int file_handle = open(file_name, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (file_handle >= 0)
+	{
+		result = write(file_handle, file.content, file.content_size) == static_cast<ssize_t>(file.content_size);
+		close(file_handle);
+	}
+
+	return result;
+}
+
+PLATFORM_FREE_FILE(Linux_FreeFile)
+{
+	if (file.content)
+	{
+		munmap(file.content, file.content_size);
+	}
+
+	file = {};
+}
+
+PLATFORM_REPORT_ARENA_OVERFLOW(Linux_ReportArenaOverflow)
+{
+	fprintf(stderr, "Arena overflow: tag %s requested %llu bytes with %llu of %llu used\n",
+		tag_name, static_cast<unsigned long long>(requested_size), static_cast<unsigned long long>(used), static_cast<unsigned long long>(size));
+}
+
+//Note: returns the value following flag, or default_value when the flag is not there
+internal_static u32 Linux_GetCommandLineValue(int argument_count, char** arguments, const char* flag, u32 default_value)
+{
+	u32 result = default_value;
+	for (int argument_index = 1; argument_index + 1 < argument_count; ++argument_index)
+	{
+		if (strcmp(arguments[argument_index], flag) == 0)
+		{
+			result = static_cast<u32>(strtoul(arguments[argument_index + 1], nullptr, 10));
+		}
+	}
+
+	return result;
+}
+
+internal_static b32 Linux_HasCommandLineFlag(int argument_count, char** arguments, const char* flag)
+{
+	b32 result = false;
+	for (int argument_index = 1; argument_index < argument_count; ++argument_index)
+	{
+		if (strcmp(arguments[argument_index], flag) == 0)
+		{
+			result = true;
+		}
+	}
+
+	return result;
+}
+
+//Note: starts the game, then walks the hero around in a fixed pattern so every run sees the same frames
+internal_static void Linux_ScriptInput(GameInput& input, u32 frame_index)
+{
+	input = {};
+	input.frame_delta = 1.f / 30.f;
+
+	GameControllerInput& controller = input.controllers[0];
+	controller.is_connected = true;
+	controller.start.is_ended_down = (frame_index == 1);
+	controller.move_right.is_ended_down = (frame_index / 40) % 2 == 0;
+	controller.move_up.is_ended_down = (frame_index / 60) % 2 == 1;
+	controller.action_up.is_ended_down = (frame_index % 50) == 0;
+}
+
+//Note: fnv-1a over the visible pixels
+internal_static u64 Linux_HashBuffer(const GameOffscreenBuffer& buffer)
+{
+	u64 result = 0xcbf29ce484222325ull;
+	for (i32 y = 0; y < buffer.height; ++y)
+	{
+		const u8* row = static_cast<const u8*>(buffer.memory) + y * buffer.pitch;
+		for (i32 byte_index = 0; byte_index < buffer.width * buffer.bytes_per_pixel; ++byte_index)
+		{
+			result = (result ^ row[byte_index]) * 0x100000001b3ull;
+		}
+	}
+
+	return result;
+}
+
+struct Linux_GameRun
+{
+	b32 is_valid;
+	u64 frame_hash;
+	StoragePageMode page_mode;
+
+	u64 reserved_bytes;
+	u64 committed_bytes;
+	u64 buffer_size;
+	b32 commit_on_demand;
+	u64 resident_before;
+	u64 resident_after;
+
+	DebugCycleCounter counters[DebugCycleCounter_Count]; //Note: summed over every frame of the run
+	u64 redrawn_pixel_count;
+	u32 full_redraw_count;
+	ArenaTagStats arena_tag_stats[ArenaTag_Count]; //Note: the last frame's, with the highest per-frame peak of the run
+
+	u32 check_count;
+	DebugCheckResult checks[DEBUG_CHECK_MAX_COUNT];
+};
+
+//Note: every run gets its own storage, so the game starts over from a zeroed permanent storage each time
+internal_static Linux_GameRun Linux_RunGame(u32 frame_count, StoragePageMode page_mode, PlatformWorkQueue* queue, u32 thread_count, b32 run_checks, b32 force_full_redraw)
+{
+	Linux_GameRun result{};
+
+	ThreadContext thread = {};
+
+	GameMemory memory = {};
+	memory.permanent_storage_size = MegaBytes(256);
+	memory.transient_storage_size = GigaBytes(1);
+	memory.Debug_PlatformRead = Linux_ReadFile;
+	memory.Debug_PlatformWrite = Linux_WriteFile;
+	memory.Debug_PlatformFree = Linux_FreeFile;
+	memory.PlatformReportArenaOverflow = Linux_ReportArenaOverflow;
+	memory.PlatformGetWallClockMicroseconds = Linux_GetWallClockMicroseconds;
+	if (queue)
+	{
+		memory.work_queue = queue;
+		memory.work_queue_thread_count = thread_count;
+		memory.PlatformAddWorkEntry = Linux_AddWorkEntry;
+		memory.PlatformCompleteAllWork = Linux_CompleteAllWork;
+	}
+
+	memory.debug_run_checks = run_checks;
+	memory.debug_force_full_redraw = force_full_redraw;
+
+	global_linux_committed_bytes = 0;
+	Linux_MemoryBlock memory_block = Linux_ReserveGameStorage(nullptr, memory.permanent_storage_size, memory.transient_storage_size,
+		memory.permanent_storage, memory.transient_storage, page_mode);
+	if (!memory_block.base)
+	{
+		fprintf(stderr, "Could not reserve %llu bytes of game storage\n", static_cast<unsigned long long>(memory.permanent_storage_size + memory.transient_storage_size));
+		return result;
+	}
+	memory.storage_page_mode = memory_block.page_mode;
+	memory.PlatformCommitMemory = memory_block.commit_on_demand ? Linux_CommitMemory : nullptr;
+	global_linux_commit_block = &memory_block;
+
+	GameOffscreenBuffer buffer = {};
+	buffer.width = LinuxBufferWidth;
+	buffer.height = LinuxBufferHeight;
+	buffer.bytes_per_pixel = 4;
+	buffer.pitch = buffer.width * buffer.bytes_per_pixel;
+	u64 buffer_size = static_cast<u64>(buffer.pitch) * static_cast<u64>(buffer.height);
+	buffer.memory = mmap(nullptr, buffer_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (buffer.memory == MAP_FAILED)
+	{
+		fprintf(stderr, "Could not map the offscreen buffer\n");
+		Linux_ReleaseMemory(memory_block);
+		return result;
+	}
+
+	result.resident_before = Linux_GetResidentBytes();
+
+	GameInput input = {};
+	for (u32 frame_index = 0; frame_index < frame_count; ++frame_index)
+	{
+		Linux_ScriptInput(input, frame_index);
+		PlatformLoop(thread, &memory, &input, buffer);
+		result.redrawn_pixel_count += memory.dirty_region.redrawn_pixel_count;
+		result.full_redraw_count += memory.dirty_region.is_full ? 1 : 0;
+		for (u32 tag_index = 0; tag_index < ArenaTag_Count; ++tag_index)
+		{
+			ArenaTagStats& stats = result.arena_tag_stats[tag_index];
+			stats.live = memory.arena_tag_stats[tag_index].live;
+			stats.peak = Maximum(stats.peak, memory.arena_tag_stats[tag_index].peak);
+			stats.push_count = memory.arena_tag_stats[tag_index].push_count;
+		}
+	}
+
+	result.resident_after = Linux_GetResidentBytes();
+
+	result.is_valid = true;
+	result.frame_hash = Linux_HashBuffer(buffer);
+	result.page_mode = memory_block.page_mode;
+	result.reserved_bytes = memory_block.size;
+	result.committed_bytes = global_linux_committed_bytes;
+	result.buffer_size = buffer_size;
+	result.commit_on_demand = memory_block.commit_on_demand;
+	for (u32 counter_index = 0; counter_index < DebugCycleCounter_Count; ++counter_index)
+	{
+		result.counters[counter_index] = memory.counters[counter_index];
+	}
+	result.check_count = memory.debug_check_count;
+	for (u32 check_index = 0; check_index < memory.debug_check_count; ++check_index)
+	{
+		result.checks[check_index] = memory.debug_checks[check_index];
+	}
+
+	munmap(buffer.memory, buffer_size);
+	Linux_ReleaseMemory(memory_block);
+
+	return result;
+}
+
+internal_static u64 Linux_CyclesPerHit(const DebugCycleCounter& counter)
+{
+	return counter.hit_count ? counter.cycle_count / counter.hit_count : 0;
+}
+
+internal_static void Linux_PrintCounterColumns(const Linux_GameRun& a, const Linux_GameRun& b)
+{
+	for (u32 counter_index = 0; counter_index < DebugCycleCounter_Count; ++counter_index)
+	{
+		printf("  %-16s %12llu %12llu\n", debug_cycle_counter_names[counter_index],
+			static_cast<unsigned long long>(Linux_CyclesPerHit(a.counters[counter_index])),
+			static_cast<unsigned long long>(Linux_CyclesPerHit(b.counters[counter_index])));
+	}
+}
+
+int main(int argument_count, char** arguments)
+{
+	u32 frame_count = Linux_GetCommandLineValue(argument_count, arguments, "--frames", 600);
+	b32 check_resident = Linux_HasCommandLineFlag(argument_count, arguments, "--check-resident");
+	b32 compare_pages = Linux_HasCommandLineFlag(argument_count, arguments, "--compare-pages");
+	b32 compare_dirty = Linux_HasCommandLineFlag(argument_count, arguments, "--compare-dirty");
+	b32 run_checks = Linux_HasCommandLineFlag(argument_count, arguments, "--check");
+	StoragePageMode page_mode = Linux_HasCommandLineFlag(argument_count, arguments, "--huge") ? StoragePageMode_Huge : StoragePageMode_Normal;
+
+	//Note: with --threads 0 the queue is still used, the main thread just works through all of it alone
+	local_static PlatformWorkQueue work_queue;
+	PlatformWorkQueue* queue = nullptr;
+	u32 thread_count = Linux_GetCommandLineValue(argument_count, arguments, "--threads", 0);
+	if (Linux_HasCommandLineFlag(argument_count, arguments, "--threads"))
+	{
+		Linux_MakeWorkQueue(work_queue, thread_count);
+		queue = &work_queue;
+	}
+
+	Linux_GameRun run = Linux_RunGame(frame_count, compare_pages ? StoragePageMode_Normal : page_mode, queue, thread_count, run_checks, false);
+	if (!run.is_valid)
+	{
+		return 1;
+	}
+
+	printf("frames %u hash %016llx\n", frame_count, static_cast<unsigned long long>(run.frame_hash));
+	printf("reserved %llu KB committed %llu KB resident %llu KB -> %llu KB\n",
+		static_cast<unsigned long long>(run.reserved_bytes / 1024), static_cast<unsigned long long>(run.committed_bytes / 1024),
+		static_cast<unsigned long long>(run.resident_before / 1024), static_cast<unsigned long long>(run.resident_after / 1024));
+	for (u32 tag_index = 0; tag_index < ArenaTag_Count; ++tag_index)
+	{
+		const ArenaTagStats& stats = run.arena_tag_stats[tag_index];
+		if (stats.push_count)
+		{
+			printf("arena %-12s live %8llu KB peak %8llu KB\n", arena_tag_names[tag_index],
+				static_cast<unsigned long long>(stats.live / 1024), static_cast<unsigned long long>(stats.peak / 1024));
+		}
+	}
+
+	int result = 0;
+	if (run_checks)
+	{
+		for (u32 check_index = 0; check_index < run.check_count; ++check_index)
+		{
+			const DebugCheckResult& check = run.checks[check_index];
+			printf("check %-20s reference %12llucy optimized %12llucy %6.2fx mismatches %u\n", check.name,
+				static_cast<unsigned long long>(check.reference_cycles), static_cast<unsigned long long>(check.optimized_cycles),
+				check.optimized_cycles ? static_cast<r64>(check.reference_cycles) / static_cast<r64>(check.optimized_cycles) : 0.0,
+				check.mismatch_count);
+			if (check.mismatch_count)
+			{
+				result = 1;
+			}
+		}
+
+		if (!run.check_count)
+		{
+			fprintf(stderr, "No checks ran\n");
+			result = 1;
+		}
+	}
+
+	if (check_resident)
+	{
+		//Note: committing only makes pages writable, so the growth has to stay within what the game committed and touched,
+		//the offscreen buffer and some slack, far below the reservation
+		u64 resident_growth = (run.resident_after > run.resident_before) ? run.resident_after - run.resident_before : 0;
+		u64 allowed_growth = run.committed_bytes + run.buffer_size + LinuxResidentSlack;
+		if (!run.commit_on_demand || resident_growth > allowed_growth || resident_growth * 8 > run.reserved_bytes)
+		{
+			fprintf(stderr, "Resident memory grew by %llu KB, allowed %llu KB\n",
+				static_cast<unsigned long long>(resident_growth / 1024), static_cast<unsigned long long>(allowed_growth / 1024));
+			result = 1;
+		}
+	}
+
+	if (compare_pages)
+	{
+		//Note: the same frames again on huge pages, so only the page size differs between the two columns
+		Linux_GameRun huge_run = Linux_RunGame(frame_count, StoragePageMode_Huge, queue, thread_count, false, false);
+		if (!huge_run.is_valid)
+		{
+			return 1;
+		}
+
+		if (huge_run.frame_hash != run.frame_hash)
+		{
+			fprintf(stderr, "Huge page run drew a different frame\n");
+			result = 1;
+		}
+
+		printf("cycles/hit over %u frames, normal pages vs %s:\n", frame_count,
+			huge_run.page_mode == StoragePageMode_Huge ? "huge pages" : "normal pages (huge pages refused)");
+		Linux_PrintCounterColumns(run, huge_run);
+	}
+
+	if (compare_dirty)
+	{
+		//Note: the same frames again redrawn in full every frame, what the game did before it tracked dirty rects
+		Linux_GameRun full_run = Linux_RunGame(frame_count, run.page_mode, queue, thread_count, false, true);
+		if (!full_run.is_valid)
+		{
+			return 1;
+		}
+
+		if (full_run.frame_hash != run.frame_hash)
+		{
+			fprintf(stderr, "Full redraw run drew a different frame\n");
+			result = 1;
+		}
+
+		u64 buffer_pixel_count = static_cast<u64>(LinuxBufferWidth) * static_cast<u64>(LinuxBufferHeight);
+		u64 frame_divisor = frame_count ? frame_count : 1;
+		printf("redrawn pixels/frame over %u frames, dirty rects vs full redraw:\n", frame_count);
+		printf("  %-16s %12llu %12llu (%.1f%% of the buffer, %u of the frames in full)\n", "RedrawnPixels",
+			static_cast<unsigned long long>(run.redrawn_pixel_count / frame_divisor),
+			static_cast<unsigned long long>(full_run.redrawn_pixel_count / frame_divisor),
+			100.0 * static_cast<r64>(run.redrawn_pixel_count) / static_cast<r64>(buffer_pixel_count * frame_divisor),
+			run.full_redraw_count);
+		printf("cycles/hit over %u frames, dirty rects vs full redraw:\n", frame_count);
+		Linux_PrintCounterColumns(run, full_run);
+	}
+
+	return result;
+}
+
+#endif
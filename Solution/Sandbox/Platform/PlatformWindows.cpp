@@ -19,7 +19,6 @@ TODO: partial list of stuff todo
 - Saved game locations
 - handle to executable
 - asset loading path
-- threading
 - raw input
 - sleep
 - cursor clip
@@ -70,6 +69,13 @@ struct Win32_GameCode
 };
 
 constexpr auto WinPathNameCount = MAX_PATH;
+constexpr u64 WinStorageGuardSize = KiloBytes(64); //Note: reserved but never committed, one after each storage
+
+struct Win32_CommittedRegion
+{
+	u64 offset;
+	u64 size;
+};
 
 struct Win32_ReplayBuffer
 {
@@ -77,6 +83,28 @@ struct Win32_ReplayBuffer
 	HANDLE memory_map;
 	char filename[WinPathNameCount];
 	void* memory_block;
+
+	u32 committed_region_count;
+	Win32_CommittedRegion committed_regions[256];
+};
+
+struct PlatformWorkQueueEntry
+{
+	FuncPlatformWorkQueueCallback* callback;
+	void* data;
+};
+
+//Note: a ring written only by the main thread, the workers and the main thread race to claim entries with a compare exchange
+struct PlatformWorkQueue
+{
+	u32 volatile completion_goal;
+	u32 volatile completion_count;
+
+	u32 volatile next_entry_to_write;
+	u32 volatile next_entry_to_read;
+	HANDLE semaphore_handle;
+
+	PlatformWorkQueueEntry entries[256];
 };
 
 struct Win32_State
@@ -91,6 +119,9 @@ struct Win32_State
 	HANDLE playback_handle;
 	int input_playing_index = 0;
 
+	//Note: set when game memory is restored, the game's dirty tracker then describes a back buffer it never drew
+	b32 full_redraw_pending = false;
+
 	char exe_filepath[WinPathNameCount];
 	char* exe_filename;
 };
@@ -106,6 +137,10 @@ global_static r32* global_audio_memory;
 global_static i64 global_performance_frequency;
 
 global_static b32 DEBUG_show_cursor;
+global_static b32 DEBUG_report_cycle_counters; //Note: toggled with C
+
+constexpr u32 Win32DebugReportFrameCount = 120; //Note: frames summed into each cycle counter report
+constexpr r64 Win32MaxFrameDeltaSeconds = 0.25; //Note: a longer frame, a breakpoint or a dragged window, is handed on as this
 
 global_static WINDOWPLACEMENT window_position{ sizeof(window_position), 0, 0, {}, {}, {} };
 
@@ -216,6 +251,28 @@ ENGINE_API PLATFORM_FREE_FILE(PlatformFreeDefinition)
 	VirtualFree(file.content, 0, MEM_RELEASE);
 }
 
+extern "C" 
+ENGINE_API PLATFORM_COMMIT_MEMORY(PlatformCommitMemoryDefinition)
+{
+	//Note: committing pages that are already committed is allowed, fresh pages are zeroed by the os
+	return VirtualAlloc(base, size, MEM_COMMIT, PAGE_READWRITE) != nullptr;
+}
+
+extern "C" 
+ENGINE_API PLATFORM_REPORT_ARENA_OVERFLOW(PlatformReportArenaOverflowDefinition)
+{
+	char message[256];
+	sprintf(message, "Arena overflow: tag %s requested %llu bytes with %llu of %llu used\n", 
+		tag_name, static_cast<u64>(requested_size), static_cast<u64>(used), static_cast<u64>(size));
+
+	OutputDebugStringA(message);
+	fputs(message, stderr);
+	MessageBoxA(nullptr, message, "Game Engine", MB_OK | MB_ICONERROR);
+
+	//Note: continuing would hand out memory past the end of the arena
+	ExitProcess(1);
+}
+
 
 internal_static void ConcatStrings(u64 source_a_count, char* source_a, u64 source_b_count, char* source_b, u64 dest_count, char* dest)
 {
@@ -243,6 +300,29 @@ internal_static u64 StringLength(char* file_name)
 	return length;
 }
 
+internal_static b32 Win32_HasCommandLineFlag(char* command_line, char* flag)
+{
+	u64 flag_length = StringLength(flag);
+	for (char* scan = command_line; scan && *scan; ++scan)
+	{
+		b32 starts_token = (scan == command_line) || scan[-1] == ' ' || scan[-1] == '\t';
+
+		u64 match_length = 0;
+		while (starts_token && match_length < flag_length && scan[match_length] == flag[match_length])
+		{
+			++match_length;
+		}
+
+		//Note: a whole token only, -large_pages must not match -large_pages_off
+		char end = scan[match_length];
+		if (starts_token && match_length == flag_length && (end == 0 || end == ' ' || end == '\t'))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
 
 internal_static void Win32_BuildEXEFilepath(Win32_State& state, char* file_name, u64 dest_count, char* dest)
 {
@@ -264,6 +344,59 @@ internal_static Win32_ReplayBuffer& Win32_GetReplayBuffer(Win32_State& state, in
 	return state.replay_buffers[recording_index];
 }
 
+//Note: game memory is only partly committed, touching the rest would fault, so copy region by region
+internal_static void Win32_SnapshotCommittedMemory(Win32_State& state, Win32_ReplayBuffer& replay_buffer)
+{
+	replay_buffer.committed_region_count = 0;
+
+	u8* block = static_cast<u8*>(state.memory_block);
+	u8* block_end = block + state.memory_size;
+	u8* scan = block;
+	while (scan < block_end)
+	{
+		MEMORY_BASIC_INFORMATION info;
+		if (!VirtualQuery(scan, &info, sizeof(info)))
+		{
+			Halt();
+			break;
+		}
+
+		u8* region_end = static_cast<u8*>(info.BaseAddress) + info.RegionSize;
+		if (region_end > block_end)
+		{
+			region_end = block_end;
+		}
+
+		if (info.State == MEM_COMMIT)
+		{
+			Assert(replay_buffer.committed_region_count < ArrayCount(replay_buffer.committed_regions));
+			Win32_CommittedRegion& region = replay_buffer.committed_regions[replay_buffer.committed_region_count++];
+			region.offset = static_cast<u64>(scan - block);
+			region.size = static_cast<u64>(region_end - scan);
+
+			CopyMemory(static_cast<u8*>(replay_buffer.memory_block) + region.offset, scan, region.size);
+		}
+
+		scan = region_end;
+	}
+}
+
+internal_static void Win32_RestoreCommittedMemory(Win32_State& state, Win32_ReplayBuffer& replay_buffer)
+{
+	//Note: decommit first so pages committed after the snapshot go back to reading as zero
+	VirtualFree(state.memory_block, state.memory_size, MEM_DECOMMIT);
+
+	u8* block = static_cast<u8*>(state.memory_block);
+	for (u32 region_index = 0; region_index < replay_buffer.committed_region_count; ++region_index)
+	{
+		Win32_CommittedRegion& region = replay_buffer.committed_regions[region_index];
+		VirtualAlloc(block + region.offset, region.size, MEM_COMMIT, PAGE_READWRITE);
+		CopyMemory(block + region.offset, static_cast<u8*>(replay_buffer.memory_block) + region.offset, region.size);
+	}
+
+	state.full_redraw_pending = true;
+}
+
 internal_static void Win32_BeginRecordingInput(Win32_State& state, int input_recording_index)
 {
 	auto& replay_buffer = Win32_GetReplayBuffer(state, input_recording_index);
@@ -275,7 +408,7 @@ internal_static void Win32_BeginRecordingInput(Win32_State& state, int input_rec
 		Win32_GetInputFileLocation(state, true, input_recording_index, sizeof(filename), filename);
 		state.recording_handle = CreateFileA(filename, GENERIC_WRITE, NULL, nullptr, CREATE_ALWAYS, NULL, nullptr);
 
-		CopyMemory(replay_buffer.memory_block, state.memory_block, state.memory_size);
+		Win32_SnapshotCommittedMemory(state, replay_buffer);
 	}
 }
 
@@ -296,7 +429,7 @@ internal_static void Win32_BeginPlaybackInput(Win32_State& state, int input_play
 		Win32_GetInputFileLocation(state, true, input_playing_index, sizeof(filename), filename);
 		state.playback_handle = CreateFileA(filename, GENERIC_READ, NULL, nullptr, OPEN_EXISTING, NULL, nullptr);
 
-		CopyMemory(state.memory_block, replay_buffer.memory_block, state.memory_size);
+		Win32_RestoreCommittedMemory(state, replay_buffer);
 	}
 }
 
@@ -328,6 +461,120 @@ internal_static void Win32_PlayBackInput(Win32_State& state, GameInput& input)
 	
 }
 
+//Note: large pages need SeLockMemoryPrivilege granted to the user, it still has to be enabled on the token
+internal_static b32 Win32_EnableLockMemoryPrivilege()
+{
+	b32 result = false;
+
+	HANDLE token;
+	if (OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token))
+	{
+		TOKEN_PRIVILEGES privileges{};
+		privileges.PrivilegeCount = 1;
+		privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+		if (LookupPrivilegeValue(nullptr, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid))
+		{
+			AdjustTokenPrivileges(token, FALSE, &privileges, 0, nullptr, nullptr);
+			result = (GetLastError() == ERROR_SUCCESS);
+		}
+
+		CloseHandle(token);
+	}
+
+	return result;
+}
+
+//Note: large pages cannot be reserved and committed later, the whole block is committed and locked at once
+internal_static void* Win32_AllocateLargePages(LPVOID base_address, u64& size)
+{
+	void* result = nullptr;
+
+	u64 large_page_size = GetLargePageMinimum();
+	if (large_page_size && Win32_EnableLockMemoryPrivilege())
+	{
+		u64 large_size = (size + large_page_size - 1) & ~(large_page_size - 1);
+		result = VirtualAlloc(base_address, large_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+		if (result)
+		{
+			size = large_size;
+		}
+	}
+
+	return result;
+}
+
+//Note: the counters add up between reports, so every line is an average over the whole interval. Nothing is printed
+//unless reporting was switched on with C
+internal_static void Win32_HandleDebugCycleCounters(GameMemory& memory)
+{
+	local_static u32 frames_since_report;
+	local_static u64 redrawn_pixel_count; //Note: over the frames since the last report, next to the counters
+	local_static u32 full_redraw_count;
+	local_static MemoryIndex arena_tag_peaks[ArenaTag_Count]; //Note: the highest of the game's per-frame peaks
+	redrawn_pixel_count += memory.dirty_region.redrawn_pixel_count;
+	full_redraw_count += memory.dirty_region.is_full ? 1 : 0;
+	for (u32 tag_index = 0; tag_index < ArenaTag_Count; ++tag_index)
+	{
+		arena_tag_peaks[tag_index] = Maximum(arena_tag_peaks[tag_index], memory.arena_tag_stats[tag_index].peak);
+	}
+	if (++frames_since_report >= Win32DebugReportFrameCount)
+	{
+		if (DEBUG_report_cycle_counters)
+		{
+			char text_buffer[2048];
+			i32 length = snprintf(text_buffer, sizeof(text_buffer), "DEBUG CYCLE COUNTS over %u frames%s:\n",
+				frames_since_report, memory.storage_page_mode == StoragePageMode_Huge ? " (large pages)" : "");
+			for (u32 counter_index = 0; counter_index < ArrayCount(memory.counters); ++counter_index)
+			{
+				const DebugCycleCounter& counter = memory.counters[counter_index];
+				if (counter.hit_count && length >= 0 && static_cast<u64>(length) < sizeof(text_buffer))
+				{
+					length += snprintf(text_buffer + length, sizeof(text_buffer) - static_cast<u64>(length), "  %s: %llucy/frame %llucy/h\n",
+						debug_cycle_counter_names[counter_index],
+						counter.cycle_count / frames_since_report,
+						counter.cycle_count / counter.hit_count);
+				}
+			}
+
+			if (length >= 0 && static_cast<u64>(length) < sizeof(text_buffer))
+			{
+				//Note: a full redraw every frame, as before the dirty rects, is the buffer's pixel count
+				u64 buffer_pixel_count = static_cast<u64>(global_back_buffer.width) * static_cast<u64>(global_back_buffer.height);
+				length += snprintf(text_buffer + length, sizeof(text_buffer) - static_cast<u64>(length), "  RedrawnPixels: %llu/frame of %llu, %u of the frames in full\n",
+					redrawn_pixel_count / frames_since_report,
+					buffer_pixel_count,
+					full_redraw_count);
+			}
+
+			for (u32 tag_index = 0; tag_index < ArenaTag_Count; ++tag_index)
+			{
+				const ArenaTagStats& stats = memory.arena_tag_stats[tag_index];
+				if (stats.push_count && length >= 0 && static_cast<u64>(length) < sizeof(text_buffer))
+				{
+					length += snprintf(text_buffer + length, sizeof(text_buffer) - static_cast<u64>(length), "  Arena %s: %lluKB live %lluKB peak\n",
+						arena_tag_names[tag_index],
+						stats.live / 1024,
+						arena_tag_peaks[tag_index] / 1024);
+				}
+			}
+			OutputDebugStringA(text_buffer);
+		}
+
+		for (u32 counter_index = 0; counter_index < ArrayCount(memory.counters); ++counter_index)
+		{
+			memory.counters[counter_index] = {};
+		}
+		frames_since_report = 0;
+		redrawn_pixel_count = 0;
+		full_redraw_count = 0;
+		for (u32 tag_index = 0; tag_index < ArenaTag_Count; ++tag_index)
+		{
+			arena_tag_peaks[tag_index] = 0;
+		}
+	}
+}
+
 internal_static FILETIME Win32_GetFileLastWriteTime(char* filename)
 {
 	WIN32_FILE_ATTRIBUTE_DATA file_data;
@@ -535,43 +782,60 @@ internal_static void Win32_ResizeDIBSection(Win32_BitmapBuffer* bitmap_buffer, i
 	bitmap_buffer->pitch = width * bitmap_buffer->bytes_per_pixel;
 }
 
-internal_static void Win32_DisplayBufferInWindow(HDC device_context, Win32_BitmapBuffer bitmap_buffer, int window_width, int window_height)
+internal_static void Win32_StretchBufferToWindow(HDC device_context, const Win32_BitmapBuffer& bitmap_buffer, i32 offset_x, i32 offset_y, i32 scale)
 {
+	StretchDIBits(
+		device_context,
+		offset_x, offset_y, scale * bitmap_buffer.width, scale * bitmap_buffer.height, //For shipping: window_width, window_height
+		0, 0, bitmap_buffer.width, bitmap_buffer.height,
+		bitmap_buffer.memory,
+		&bitmap_buffer.info,
+		DIB_RGB_COLORS,
+		SRCCOPY
+	);
+}
+
+//Note: dirty_region is null when the whole buffer has to go out, as for WM_PAINT. Otherwise only its rectangles are
+//presented, each as a clip rect on the device context around the same whole-buffer blit
+internal_static void Win32_DisplayBufferInWindow(HDC device_context, Win32_BitmapBuffer bitmap_buffer, int window_width, int window_height, const GameDirtyRegion* dirty_region)
+{
+	i32 scale = 1;
+	i32 offset_x = 10;
+	i32 offset_y = 10;
 	if (window_width >= bitmap_buffer.width * 2 && 
 		window_height >= bitmap_buffer.height * 2)
 	{
-		StretchDIBits(
-			device_context,
-			0, 0, 2 * bitmap_buffer.width, 2 * bitmap_buffer.height, //For shipping: window_width, window_height
-			0, 0, bitmap_buffer.width, bitmap_buffer.height,
-			bitmap_buffer.memory,
-			&bitmap_buffer.info,
-			DIB_RGB_COLORS,
-			SRCCOPY
-		);
+		scale = 2;
+		offset_x = 0;
+		offset_y = 0;
 	}
-	else
-	{
-		i32 offset_x = 10;
-		i32 offset_y = 10;
-
-		//Clear screen
-		PatBlt(device_context, 0, 0, window_width, offset_y, BLACKNESS);
-		PatBlt(device_context, 0, offset_y + bitmap_buffer.height, window_width, window_height, BLACKNESS);
-		PatBlt(device_context, 0, 0, offset_x, window_height, BLACKNESS);
-		PatBlt(device_context, offset_x + bitmap_buffer.width, 0, window_width, window_height, BLACKNESS);
 
+	if (!dirty_region || dirty_region->is_full)
+	{
+		if (scale == 1)
+		{
+			//Clear screen
+			PatBlt(device_context, 0, 0, window_width, offset_y, BLACKNESS);
+			PatBlt(device_context, 0, offset_y + bitmap_buffer.height, window_width, window_height, BLACKNESS);
+			PatBlt(device_context, 0, 0, offset_x, window_height, BLACKNESS);
+			PatBlt(device_context, offset_x + bitmap_buffer.width, 0, window_width, window_height, BLACKNESS);
+		}
 
 		//aspect ratio correction
-		StretchDIBits(
-			device_context,
-			offset_x, offset_y, bitmap_buffer.width, bitmap_buffer.height, //For shipping: window_width, window_height
-			0, 0, bitmap_buffer.width, bitmap_buffer.height,
-			bitmap_buffer.memory,
-			&bitmap_buffer.info,
-			DIB_RGB_COLORS,
-			SRCCOPY
-		);
+		Win32_StretchBufferToWindow(device_context, bitmap_buffer, offset_x, offset_y, scale);
+	}
+	else
+	{
+		for (u32 rect_index = 0; rect_index < dirty_region->rect_count; ++rect_index)
+		{
+			const Rectangle2i& rect = dirty_region->rects[rect_index];
+			SaveDC(device_context);
+			IntersectClipRect(device_context,
+				offset_x + scale * rect.min_x, offset_y + scale * rect.min_y,
+				offset_x + scale * rect.max_x, offset_y + scale * rect.max_y);
+			Win32_StretchBufferToWindow(device_context, bitmap_buffer, offset_x, offset_y, scale);
+			RestoreDC(device_context, -1);
+		}
 	}
 }
 
@@ -699,6 +963,14 @@ internal_static void Win32_ProcessPendingMessages(Win32_State& state, GameContro
 						}
 					}
 
+					if (vk_code == 'C')
+					{
+						if (is_down)
+						{
+							DEBUG_report_cycle_counters = !DEBUG_report_cycle_counters;
+						}
+					}
+
 					bool alt_down = (l_param & (1u << 29)) != 0;
 					if (vk_code == VK_F4 && alt_down)
 					{
@@ -796,6 +1068,15 @@ inline r64 Win32_GetSecondElapsed(LARGE_INTEGER start, LARGE_INTEGER end)
 	return static_cast<r64>(end.QuadPart - start.QuadPart) / static_cast<r64>(global_performance_frequency);
 }
 
+extern "C" 
+ENGINE_API PLATFORM_GET_WALL_CLOCK_MICROSECONDS(PlatformGetWallClockMicrosecondsDefinition)
+{
+	//Note: split so the multiply cannot overflow on a long running counter
+	u64 counter = static_cast<u64>(Win32_GetWallClock().QuadPart);
+	u64 frequency = static_cast<u64>(global_performance_frequency);
+	return (counter / frequency) * 1000000 + ((counter % frequency) * 1000000) / frequency;
+}
+
 LRESULT CALLBACK Win32_WindowCallback(HWND window_handle, UINT message, WPARAM w_param, LPARAM l_param)
 {
 	LRESULT result = 0;
@@ -859,7 +1140,7 @@ LRESULT CALLBACK Win32_WindowCallback(HWND window_handle, UINT message, WPARAM w
 		PAINTSTRUCT paint;
 		HDC device_context = BeginPaint(window_handle, &paint);
 		auto dimension = Win32_GetWindowDimension(window_handle);
-		Win32_DisplayBufferInWindow(device_context, global_back_buffer, dimension.width, dimension.height);
+		Win32_DisplayBufferInWindow(device_context, global_back_buffer, dimension.width, dimension.height, nullptr);
 		EndPaint(window_handle, &paint);
 	} break;
 
@@ -872,6 +1153,92 @@ LRESULT CALLBACK Win32_WindowCallback(HWND window_handle, UINT message, WPARAM w
 	return result;
 }
 
+extern "C" 
+ENGINE_API PLATFORM_ADD_WORK_ENTRY(PlatformAddWorkEntryDefinition)
+{
+	u32 new_next_entry_to_write = (queue->next_entry_to_write + 1) % ArrayCount(queue->entries);
+	Assert(new_next_entry_to_write != queue->next_entry_to_read);
+
+	PlatformWorkQueueEntry& entry = queue->entries[queue->next_entry_to_write];
+	entry.callback = callback;
+	entry.data = data;
+	queue->completion_goal = queue->completion_goal + 1; //Note: only this thread writes it
+
+	//Note: the entry has to be visible before the index that publishes it
+	_WriteBarrier();
+	queue->next_entry_to_write = new_next_entry_to_write;
+	ReleaseSemaphore(queue->semaphore_handle, 1, nullptr);
+}
+
+//Note: returns true when there was nothing to do
+internal_static b32 Win32_DoNextWorkQueueEntry(PlatformWorkQueue* queue)
+{
+	b32 should_sleep = false;
+
+	u32 original_next_entry_to_read = queue->next_entry_to_read;
+	u32 new_next_entry_to_read = (original_next_entry_to_read + 1) % ArrayCount(queue->entries);
+	if (original_next_entry_to_read != queue->next_entry_to_write)
+	{
+		u32 index = static_cast<u32>(InterlockedCompareExchange(reinterpret_cast<LONG volatile*>(&queue->next_entry_to_read),
+			static_cast<LONG>(new_next_entry_to_read), static_cast<LONG>(original_next_entry_to_read)));
+		if (index == original_next_entry_to_read)
+		{
+			PlatformWorkQueueEntry entry = queue->entries[index];
+			entry.callback(queue, entry.data);
+			InterlockedIncrement(reinterpret_cast<LONG volatile*>(&queue->completion_count));
+		}
+	}
+	else
+	{
+		should_sleep = true;
+	}
+
+	return should_sleep;
+}
+
+//Note: the calling thread works through the queue too instead of just waiting
+extern "C" 
+ENGINE_API PLATFORM_COMPLETE_ALL_WORK(PlatformCompleteAllWorkDefinition)
+{
+	while (queue->completion_goal != queue->completion_count)
+	{
+		Win32_DoNextWorkQueueEntry(queue);
+	}
+
+	queue->completion_goal = 0;
+	queue->completion_count = 0;
+}
+
+internal_static DWORD WINAPI Win32_WorkQueueThreadProc(LPVOID parameter)
+{
+	PlatformWorkQueue* queue = static_cast<PlatformWorkQueue*>(parameter);
+	while (global_running)
+	{
+		if (Win32_DoNextWorkQueueEntry(queue))
+		{
+			WaitForSingleObjectEx(queue->semaphore_handle, INFINITE, FALSE);
+		}
+	}
+
+	return 0;
+}
+
+internal_static void Win32_MakeWorkQueue(PlatformWorkQueue& queue, u32 thread_count)
+{
+	queue.completion_goal = 0;
+	queue.completion_count = 0;
+	queue.next_entry_to_write = 0;
+	queue.next_entry_to_read = 0;
+
+	LONG maximum_count = static_cast<LONG>(Maximum(thread_count, 1u));
+	queue.semaphore_handle = CreateSemaphoreEx(nullptr, 0, maximum_count, nullptr, 0, SEMAPHORE_ALL_ACCESS);
+	for (u32 thread_index = 0; thread_index < thread_count; ++thread_index)
+	{
+		HANDLE thread_handle = CreateThread(nullptr, 0, Win32_WorkQueueThreadProc, &queue, 0, nullptr);
+		CloseHandle(thread_handle);
+	}
+}
+
 int CALLBACK WinMain(HINSTANCE Instance, [[maybe_unused]] HINSTANCE PrevInstance, [[maybe_unused]] LPSTR CommandLine, [[maybe_unused]] int ShowCode)
 {
 	Win32_SetupConsole();
@@ -958,6 +1325,13 @@ int CALLBACK WinMain(HINSTANCE Instance, [[maybe_unused]] HINSTANCE PrevInstance
 			global_running = true;
 			global_paused = false;
 
+			//Note: one worker per logical processor besides this one, the main thread helps out in PlatformCompleteAllWork
+			SYSTEM_INFO system_info;
+			GetSystemInfo(&system_info);
+			u32 worker_thread_count = (system_info.dwNumberOfProcessors > 1) ? static_cast<u32>(system_info.dwNumberOfProcessors - 1) : 0;
+			PlatformWorkQueue work_queue = {};
+			Win32_MakeWorkQueue(work_queue, worker_thread_count);
+
 			r32* audio_samples = static_cast<r32*>(VirtualAlloc(nullptr, sound_output.sample_rate * sound_output.num_channels * sizeof(r32), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
 
 			LPVOID base_address = nullptr;
@@ -974,11 +1348,35 @@ int CALLBACK WinMain(HINSTANCE Instance, [[maybe_unused]] HINSTANCE PrevInstance
 			memory.Debug_PlatformRead = PlatformReadDefinition;
 			memory.Debug_PlatformWrite = PlatformWriteDefinition;
 			memory.Debug_PlatformFree = PlatformFreeDefinition;
+			memory.PlatformReportArenaOverflow = PlatformReportArenaOverflowDefinition;
+			memory.PlatformGetWallClockMicroseconds = PlatformGetWallClockMicrosecondsDefinition;
+			memory.work_queue = &work_queue;
+			memory.work_queue_thread_count = worker_thread_count;
+			memory.PlatformAddWorkEntry = PlatformAddWorkEntryDefinition;
+			memory.PlatformCompleteAllWork = PlatformCompleteAllWorkDefinition;
+
+			state.memory_size = memory.permanent_storage_size + WinStorageGuardSize + memory.transient_storage_size + WinStorageGuardSize;
+
+			if (Win32_HasCommandLineFlag(CommandLine, "-large_pages"))
+			{
+				//Note: fully committed, so there is nothing for the game to commit and the guard regions are ordinary memory
+				state.memory_block = Win32_AllocateLargePages(base_address, state.memory_size);
+				if (state.memory_block)
+				{
+					memory.storage_page_mode = StoragePageMode_Huge;
+				}
+			}
+
+			if (!state.memory_block)
+			{
+				//Note: reserve only, the game commits pages through PlatformCommitMemory as its arenas grow
+				state.memory_block = VirtualAlloc(base_address, state.memory_size, MEM_RESERVE, PAGE_NOACCESS);
+				memory.PlatformCommitMemory = PlatformCommitMemoryDefinition;
+				memory.storage_page_mode = StoragePageMode_Normal;
+			}
 
-			state.memory_size = memory.permanent_storage_size + memory.transient_storage_size;
-			state.memory_block = VirtualAlloc(base_address, state.memory_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
 			memory.permanent_storage = state.memory_block;
-			memory.transient_storage = static_cast<u8*>(memory.permanent_storage) + memory.permanent_storage_size;
+			memory.transient_storage = static_cast<u8*>(memory.permanent_storage) + memory.permanent_storage_size + WinStorageGuardSize;
 
 			for (int replay_index = 0; replay_index < static_cast<int>(ArrayCount(state.replay_buffers)); ++replay_index)
 			{
@@ -1010,6 +1408,7 @@ int CALLBACK WinMain(HINSTANCE Instance, [[maybe_unused]] HINSTANCE PrevInstance
 				GameInput& old_input = input[1];
 
 				LARGE_INTEGER last_counter = Win32_GetWallClock();
+				r64 last_frame_seconds = target_seconds_per_frame; //Note: measured, so the game's fixed ticks catch up after a long frame
 
 				auto game_code = Win32_LoadGameCode(source_game_code_dll_path, temp_game_code_dll_path, lock_full_path);
 
@@ -1017,7 +1416,7 @@ int CALLBACK WinMain(HINSTANCE Instance, [[maybe_unused]] HINSTANCE PrevInstance
 
 				while (global_running)
 				{
-					new_input.frame_delta = static_cast<r32>(target_seconds_per_frame);
+					new_input.frame_delta = static_cast<r32>(Minimum(last_frame_seconds, Win32MaxFrameDeltaSeconds));
 
 					FILETIME check_file_time = Win32_GetFileLastWriteTime(source_game_code_dll_path);
 					if (CompareFileTime(&game_code.dll_last_write_time, &check_file_time) != 0)
@@ -1151,9 +1550,16 @@ int CALLBACK WinMain(HINSTANCE Instance, [[maybe_unused]] HINSTANCE PrevInstance
 							Win32_PlayBackInput(state, new_input);
 						}
 
+						//Note: one full redraw after a restore, the frames after it go back to dirty rects
+						memory.debug_force_full_redraw = state.full_redraw_pending;
+						state.full_redraw_pending = false;
+
+						const GameDirtyRegion* dirty_region = nullptr;
 						if (game_code.Loop)
 						{
 							game_code.Loop(thread, &memory, input, buffer);
+							dirty_region = &memory.dirty_region;
+							Win32_HandleDebugCycleCounters(memory);
 						}
 
 						if (game_code.GetSoundSamples)
@@ -1180,7 +1586,7 @@ int CALLBACK WinMain(HINSTANCE Instance, [[maybe_unused]] HINSTANCE PrevInstance
 
 						HDC device_context = GetDC(window_handle);
 						auto dimension = Win32_GetWindowDimension(window_handle);
-						Win32_DisplayBufferInWindow(device_context, global_back_buffer, dimension.width, dimension.height);
+						Win32_DisplayBufferInWindow(device_context, global_back_buffer, dimension.width, dimension.height, dirty_region);
 						ReleaseDC(window_handle, device_context);
 
 						LARGE_INTEGER work_counter = Win32_GetWallClock();
@@ -1213,6 +1619,7 @@ int CALLBACK WinMain(HINSTANCE Instance, [[maybe_unused]] HINSTANCE PrevInstance
 						}
 
 						LARGE_INTEGER end_counter = Win32_GetWallClock();
+						last_frame_seconds = Win32_GetSecondElapsed(last_counter, end_counter);
 						last_counter = end_counter;
 
 						Swap(old_input, new_input);